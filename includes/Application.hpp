@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/12/17 13:42:54 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/19 14:32:23 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 01:14:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -20,11 +20,19 @@
 #include <sstream>
 
 #include <memory>
+#include <filesystem>
 
 #include "Exception.hpp"
 #include "ParticleSystem.hpp"
 #include "ImGuiLayer.hpp"
 #include "AxisGizmo.hpp"
+#include "Trajectory.hpp"
+#include "FrameExporter.hpp"
+#include "HdrRenderer.hpp"
+#include "FrameUniforms.hpp"
+#include "TrailRenderer.hpp"
+#include "Mesh.hpp"
+#include "Picture.hpp"
 
 
 class Application {
@@ -75,13 +83,30 @@ class Application {
 		GLFWwindow* _window;
 		std::unique_ptr<ParticleSystem> _system; // More modern and safer: avoids leaks
 		ImGuiLayer	_imguiLayer;
+		TrajectoryRecorder	_recorder;
+		TrajectoryPlayer	_player;
+		FrameExporter		_exporter;
+		HdrRenderer			_hdr;
+		FrameUniforms		_frame;
+		TrailRenderer		_trails;
+		bool				_exporting = false;
 		int 	_nbParticle;
 		string 	_shape;
+		string	_snapshotPath;
+		string	_cloudPath;			// --cloud: .ply or raw float32 starting state
+		int		_cloudStride = 3;	// --stride: floats per raw point
+		float	_cloudFit = 0.0f;	// --fit: radius the cloud is brought to, 0: coordinates kept
+		string	_deviceName;		// --device, empty: best guess
+		string	_deviceRequest;		// set by the UI, applied between two frames
+		string	_split;				// --split: "numa" or "name,name", empty: one device
+		string	_backend;			// --backend: "cl" or "gl", empty: OpenCL when it shares the GL buffers
 		float 	_lastFrameTime;
 		float 	_lastFpsTime;
+		float	_stepAccumulator = 0.0f;	// fixed step: simulated time still to come
 		int		_fps;
 		
 		GLuint _shaderProgram;
+		GLint _modelLoc = -1;
 
 		bool _fullscreen = false;
 		GLFWmonitor* _currentMonitor = nullptr;
@@ -98,4 +123,6 @@ class Application {
 		void initGLFW();
 		void initOpenGL();
 		void toggleFullscreen();
+		void syncExport();
+		void switchDevice(const std::string &);
 };
@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/26 12:14:32 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/01/26 12:27:11 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 18:59:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -25,13 +25,13 @@ class AxisGizmo {
 		~AxisGizmo();
 		
 		void init(GLuint shaderProgram);
-		void render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, 
-					float scale = 2.0f, glm::vec3 position = glm::vec3(0.0f));
+		void render(float scale = 2.0f, glm::vec3 position = glm::vec3(0.0f));	// camera: block Frame
 		void cleanup();
 
 	private:
 		GLuint _vao, _vbo, _ebo;
 		GLuint _shaderProgram;
+		GLint _modelLoc;
 		size_t _indexCount;
 	
 };
@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/12 14:10:42 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/01/12 14:10:43 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 11:59:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -52,6 +52,7 @@ class CameraOrbit {
 		}
 
 		glm::vec3 getTarget() const { return _target; };
+		void frame(const glm::vec3 &center, float radius, float blend = 1.0f);
 		float getLastX() const { return _lastX; };
 		float getLastY() const { return _lastY; };
 
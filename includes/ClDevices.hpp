@@ -0,0 +1,49 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ClDevices.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 12:19:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 13:59:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include <CL/cl.h>
+
+#include <string>
+#include <vector>
+
+#include "Exception.hpp"
+
+struct ClDeviceInfo {
+	cl_platform_id	platform;
+	cl_device_id	device;
+	std::string		platformName;
+	std::string		name;
+	cl_device_type	type;
+	cl_uint			computeUnits;
+	cl_ulong		globalMem;
+	bool			glSharing;		// cl_khr_gl_sharing: buffers can be shared with OpenGL
+
+	std::string label() const { return platformName + " / " + name; };
+};
+
+// Every device of every platform
+std::vector<ClDeviceInfo> listClDevices();
+
+// Empty name: best guess (GPU with GL sharing, then any GPU, then anything)
+// Otherwise the first device whose "platform / device" label contains name, case insensitive
+const ClDeviceInfo& selectClDevice(const std::vector<ClDeviceInfo>&, const std::string &name);
+
+// Comma separated names, all on the same platform (a context can't span two)
+std::vector<ClDeviceInfo> selectClDevices(const std::vector<ClDeviceInfo>&, const std::string &names);
+
+// One sub-device per NUMA node (CPU runtimes), empty if the device can't be split that way.
+// Released with clReleaseDevice.
+std::vector<cl_device_id> createNumaSubDevices(cl_device_id);
@@ -0,0 +1,77 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DeviceArena.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 16:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 16:44:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#pragma once
+
+#include <vector>
+
+#include "ResourcePool.hpp"
+
+#define ARENA_INITIAL	(1ull << 20)
+
+// One device buffer carved into sub-buffers: long-lived regions from the
+// front, per-frame scratch behind them. Offsets follow the base address
+// alignment of every device of the context.
+// Scratch is only valid until the next beginFrame and must stay on the queue
+// given to init: in-order, a later frame can't overwrite what is still read.
+class DeviceArena {
+	public:
+		DeviceArena();
+
+		DeviceArena(const DeviceArena &other) = delete;
+		DeviceArena &operator=(const DeviceArena &other) = delete;
+
+		void init(ResourcePool &pool, cl_command_queue queue, const std::vector<cl_device_id> &devices, size_t bytes);
+		void release();
+
+		// Lives with the arena, moved (content included) if the arena grows.
+		// Between frames only: the scratch starts over behind it
+		int persistent(size_t size, cl_mem_flags flags = CL_MEM_READ_WRITE);
+		cl_mem get(int region) const { return _regions[region].mem; };
+		const cl_mem* addr(int region) const { return _regions[region].mem.addr(); };
+
+		// Valid until the next beginFrame
+		cl_mem scratch(size_t size, cl_mem_flags flags = CL_MEM_READ_WRITE);
+		void beginFrame();			// scratch back to empty, grows if the last frame overflowed
+
+		size_t capacity() const { return _capacity; };
+		size_t persistentBytes() const { return _persistentEnd; };
+		size_t scratchPeak() const { return _scratchPeak; };
+
+	private:
+		struct Region {
+			size_t			offset = 0;
+			size_t			size = 0;
+			cl_mem_flags	flags = 0;
+			ClMem			mem;
+		};
+
+		ResourcePool*		_pool;
+		cl_command_queue	_queue;
+		size_t				_align;
+		size_t				_capacity;
+		ClMem				_buffer;
+
+		std::vector<Region>	_regions;			// persistent
+		size_t				_persistentEnd;
+
+		std::vector<Region>	_scratch;			// sub-buffers kept from frame to frame
+		size_t				_scratchUsed;		// slots handed out this frame
+		size_t				_scratchTop;
+		size_t				_scratchPeak;		// bytes past _persistentEnd, this frame or the last
+		std::vector<ClMem>	_overflow;			// didn't fit, released at the next frame
+
+		size_t alignUp(size_t offset) const { return (offset + _align - 1) / _align * _align; };
+		void grow(size_t bytes);
+		void carve(Region &region);
+};
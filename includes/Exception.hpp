@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/11/18 11:09:53 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/19 17:21:15 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 09:54:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -47,3 +47,11 @@ class openClError : public exception {
 	private :
 		string _msg;
 };
+
+class fileError : public exception {
+	public:
+		explicit fileError(const std::string& m) : _msg(m) {}
+		const char* what() const noexcept override { return _msg.c_str(); }
+	private :
+		string _msg;
+};
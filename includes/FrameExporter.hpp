@@ -0,0 +1,96 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FrameExporter.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 11:09:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:49:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Exception.hpp"
+
+enum class ExportFormat {
+	PNG,	// one file per frame
+	Y4M		// one raw 4:4:4 video stream, ffmpeg reads it as is
+};
+
+// Render to disk: the scene is drawn into an offscreen FBO at any resolution,
+// read back through a ring of PBOs guarded by fences so glReadPixels never
+// waits for the GPU, and encoded by a worker thread.
+class FrameExporter {
+	public:
+		FrameExporter();
+		~FrameExporter();
+
+		FrameExporter(const FrameExporter &other) = delete;
+		FrameExporter &operator=(const FrameExporter &other) = delete;
+
+		void start(const std::string &output, int width, int height, ExportFormat, int fps, int maxFrames);
+		void stop();
+
+		void beginFrame();							// binds the offscreen target
+		void endFrame(int windowWidth, int windowHeight);	// queues the readback, previews in the window
+
+		bool isActive() const { return _fbo != 0; };
+		float frameDt() const { return 1.0f / static_cast<float>(_fps); };
+		int getWidth() const { return _width; };
+		int getHeight() const { return _height; };
+		size_t getFrames() const { return _captured; };
+		void checkError();		// throws the first write failure of the worker, fileError
+
+	private:
+		static const int RING = 3;
+
+		struct Frame {
+			std::vector<uint8_t>	rgba;
+			size_t					number;
+		};
+
+		std::string		_output;
+		ExportFormat	_format;
+		int				_width;
+		int				_height;
+		int				_fps;
+		int				_maxFrames;
+
+		GLuint			_fbo;
+		GLuint			_colorRbo;
+		GLuint			_depthRbo;
+		GLuint			_pbo[RING];
+		GLsync			_fence[RING];
+		size_t			_slotFrame[RING];
+		int				_head;			// next slot written by glReadPixels
+		int				_inFlight;
+		size_t			_captured;
+
+		std::thread					_worker;
+		std::mutex					_mutex;
+		std::condition_variable		_cv;
+		std::deque<Frame>			_queue;
+		std::vector<std::vector<uint8_t>>	_free;
+		bool						_stopping;
+		FILE*						_video;
+		std::string					_error;		// first failure of the worker, under _mutex
+
+		void collect(int slot, bool wait);
+		void workerLoop();
+		void writePng(Frame &);		// compacts the pixels to RGB in place
+		void writeY4m(const Frame &);
+		void fail(const std::string &message);
+};
@@ -0,0 +1,68 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FrameUniforms.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 18:44:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 20:34:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "Exception.hpp"
+
+#define FRAME_BINDING	0			// uniform buffer binding point of the block Frame
+#define FRAME_RING		3			// persistent path: slots in flight
+
+// Mirror of the std140 block Frame declared by the shaders: vec4 and mat4
+// only, scalars packed by four, so the C++ layout is the std140 one.
+struct FrameData {
+	glm::mat4	view;
+	glm::mat4	projection;
+	glm::mat4	viewProj;
+	glm::vec4	viewport;			// width, height, 1 / width, 1 / height
+	float		time;				// simulation time
+	float		exposure;			// HDR key
+	float		pointSize;
+	float		alpha;				// particle alpha (level of detail, HDR weight)
+	int			soft;				// round sprites
+	float		interp;				// previous to current positions, 1 without fixed step
+	int			pad[2];
+};
+static_assert(sizeof(FrameData) == 240, "FrameData must match the std140 block Frame");
+
+// Per-frame camera data shared by every program: written once per frame,
+// through a persistent mapping (ring of FRAME_RING slots guarded by fences)
+// or by orphaning the buffer when glBufferStorage is missing.
+class FrameUniforms {
+	public:
+		FrameUniforms();
+		~FrameUniforms();
+
+		FrameUniforms(const FrameUniforms &other) = delete;
+		FrameUniforms &operator=(const FrameUniforms &other) = delete;
+
+		void init();					// once the GL context is current
+		void cleanup();
+
+		void upload(const FrameData &);	// binds the new data on FRAME_BINDING
+		void endFrame();				// after the last draw reading it
+
+	private:
+		GLuint	_ubo;
+		GLsizei	_stride;				// sizeof(FrameData) rounded to the offset alignment
+		char*	_mapped;
+		int		_slot;
+		GLsync	_fence[FRAME_RING];
+};
+
+// Block Frame of program on FRAME_BINDING, nothing if it doesn't use it
+void bindFrameBlock(GLuint program);
@@ -0,0 +1,56 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlCompute.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 20:44:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 20:44:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "Exception.hpp"
+#include "GlExtensions.hpp"
+
+struct GravityPoint;	// ParticleSystem.hpp
+
+#define COMPUTE_WG		128			// local_size_x of the compute shaders
+
+// GL compute backend: initShape and updateSpace as GLSL 4.3 compute shaders
+// over the vertex buffers bound as SSBOs. No OpenCL context, nothing to
+// acquire or release: the draw only waits on a memory barrier.
+class GlCompute {
+	public:
+		GlCompute();
+		~GlCompute();
+
+		GlCompute(const GlCompute &other) = delete;
+		GlCompute &operator=(const GlCompute &other) = delete;
+
+		void init();					// GL 4.3 context current, see glExt.compute
+		void cleanup();
+
+		void setGravity(const std::vector<GravityPoint> &);
+		void initShape(GLuint pos, GLuint vel, GLuint first, GLuint count, float radius, int shape,
+			GLuint speed, GLuint seed);
+		void update(GLuint pos, GLuint vel, GLuint col, GLuint count, float dt, float time,
+			GLuint colorMode, float speedScale);
+
+	private:
+		GLuint	_initProgram;
+		GLuint	_updateProgram;
+		GLuint	_gravity;				// SSBO of the sources, binding 3
+		GLuint	_nGravity;
+
+		// Uniform locations, looked up once
+		GLint	_initLoc[7];
+		GLint	_updateLoc[6];
+};
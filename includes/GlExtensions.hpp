@@ -0,0 +1,61 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlExtensions.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 12:09:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 21:29:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <glad/glad.h>
+
+// The vendored glad only covers GL 3.3: the few newer entry points we use are
+// loaded here, with the same naming, once the context is current.
+// Each feature is flagged from the context version or its ARB extension,
+// never from a non null pointer (Mesa returns stubs for any name).
+
+#define GL_MAP_PERSISTENT_BIT		0x0040
+#define GL_MAP_COHERENT_BIT			0x0080
+#define GL_DYNAMIC_STORAGE_BIT		0x0100
+#define GL_CLIENT_STORAGE_BIT		0x0200
+#define GL_DRAW_INDIRECT_BUFFER		0x8F3F
+#define GL_COMPUTE_SHADER			0x91B9
+#define GL_SHADER_STORAGE_BUFFER	0x90D2
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT	0x00000001
+#define GL_TEXTURE_FETCH_BARRIER_BIT		0x00000008
+#define GL_BUFFER_UPDATE_BARRIER_BIT		0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT		0x00002000
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+extern PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+#define glBufferStorage glad_glBufferStorage
+
+typedef void (APIENTRYP PFNGLDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect);
+extern PFNGLDRAWELEMENTSINDIRECTPROC glad_glDrawElementsIndirect;
+#define glDrawElementsIndirect glad_glDrawElementsIndirect
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint x, GLuint y, GLuint z);
+extern PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute;
+#define glDispatchCompute glad_glDispatchCompute
+
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+extern PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier;
+#define glMemoryBarrier glad_glMemoryBarrier
+
+struct GlExtensions {
+	int		major = 0;
+	int		minor = 0;
+	bool	bufferStorage = false;	// GL 4.4 / GL_ARB_buffer_storage
+	bool	drawIndirect = false;	// GL 4.0 / GL_ARB_draw_indirect
+	bool	compute = false;		// GL 4.3, compute shaders and SSBOs
+};
+
+extern GlExtensions glExt;
+
+void loadGlExtensions(GLADloadproc load);
+bool hasGlExtension(const char *name);
@@ -0,0 +1,72 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HdrRenderer.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 17:44:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 19:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Exception.hpp"
+
+#define HDR_ADAPT_SPEED		2.0f		// 1/s, eye adaptation
+
+// Additive density splatting: the particles are summed without depth into an
+// RGBA16F target, then tonemapped into the framebuffer bound before begin.
+// The exposure follows the log-average luminance of the covered pixels,
+// reduced by the mipmap chain and adapted over time in a 1x1 target by
+// blending: nothing comes back to the CPU.
+class HdrRenderer {
+	public:
+		HdrRenderer();
+		~HdrRenderer();
+
+		HdrRenderer(const HdrRenderer &other) = delete;
+		HdrRenderer &operator=(const HdrRenderer &other) = delete;
+
+		void init();								// shaders, once the GL context is current
+		void cleanup();
+
+		void begin(int width, int height);			// binds the HDR target, additive, no depth
+		void resolve(float dt);						// exposure, tonemap into the previous target
+
+		bool& enabled() { return _enabled; };
+		float& gain() { return _gain; };			// weight of one particle
+		float& key() { return _key; };				// mid-grey the average luminance maps to, FrameData::exposure
+
+	private:
+		bool	_enabled;
+		float	_gain;
+		float	_key;
+		bool	_adapted;			// false: the next resolve sets the exposure directly
+
+		int		_width;
+		int		_height;
+		int		_levels;			// mip levels of the luminance target
+		GLint	_previousFbo;
+		GLint	_previousViewport[4];
+
+		GLuint	_fbo;
+		GLuint	_color;				// RGBA16F, summed particles
+		GLuint	_lumFbo;
+		GLuint	_lum;				// RG16F: log luminance, coverage
+		GLuint	_adaptFbo;
+		GLuint	_adapt;				// R16F 1x1, adapted average luminance
+		GLuint	_vao;				// empty, the fullscreen triangle comes from gl_VertexID
+
+		GLuint	_lumProgram;
+		GLuint	_adaptProgram;
+		GLuint	_tonemapProgram;
+		GLint	_levelLoc;
+
+		void resize(int width, int height);
+		void releaseTargets();
+};
@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/09 14:18:59 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/01/26 11:45:49 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 01:29:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -20,6 +20,10 @@
 #include <backends/imgui_impl_opengl3.h>
 
 #include "ParticleSystem.hpp"
+#include "Trajectory.hpp"
+#include "FrameExporter.hpp"
+#include "Streaming.hpp"
+#include "HdrRenderer.hpp"
 
 enum class CameraMode {
 	ORBIT,
@@ -39,8 +43,17 @@ class ImGuiLayer {
 
 		void initImGui(GLFWwindow*);
 		void beginFrame();
-		void render(ParticleSystem&, CameraMode&, CameraOrbit&);
-		void renderPS(ParticleSystem&);
+		void render(ParticleSystem&, CameraMode&, CameraOrbit&, TrajectoryRecorder&, TrajectoryPlayer&, FrameExporter&, HdrRenderer&, std::string&);
+		void renderDevice(ParticleSystem&, std::string&);
+		void renderPS(ParticleSystem&, bool countLocked);		// locked while a trajectory plays
+		void renderHdr(HdrRenderer&);
+		void renderSnapshot(ParticleSystem&);
+		void renderPointCloud(ParticleSystem&);
+		void renderVectorField(ParticleSystem&);
+		void renderStreaming(ParticleSystem&);
+		void renderTrajectory(ParticleSystem&, TrajectoryRecorder&, TrajectoryPlayer&);
+		void renderExport(FrameExporter&);
+		void renderStats(ParticleSystem&, CameraOrbit&);
 		void renderCamera(CameraMode&, CameraOrbit&);
 		void endFrame();
 		void shutdown();
@@ -0,0 +1,49 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MappedFile.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 09:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 14:44:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Exception.hpp"
+
+// Thin RAII wrapper around mmap
+// The kernel pages the file in on demand: no read() copy, no parsing pass
+class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile &other) = delete;
+		MappedFile &operator=(const MappedFile &other) = delete;
+
+		void open(const std::string &path);					// read-only
+		void create(const std::string &path, size_t size);	// read-write, file truncated to size
+		void openShared(const std::string &path);			// read-write, existing file
+		void close();
+
+		// Out-of-core access: read a range ahead, or drop it from our resident set
+		void prefetch(size_t offset, size_t length);
+		void evict(size_t offset, size_t length);
+
+		bool isOpen() const { return _data != nullptr; };
+		size_t size() const { return _size; };
+		const unsigned char* data() const { return static_cast<const unsigned char*>(_data); };
+		unsigned char* data() { return static_cast<unsigned char*>(_data); };
+
+	private:
+		int		_fd;
+		void*	_data;
+		size_t	_size;
+		bool	_writable;
+};
@@ -0,0 +1,43 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Mesh.hpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 23:04:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:59:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Mesh shapes of initShape, read from a Wavefront OBJ.
+// Only "v" and "f" lines matter: faces are fanned into triangles, negative
+// (relative) indices resolved, texture and normal indices skipped.
+//
+// The mapped file is cut into chunks on line boundaries, every chunk parsed by
+// its own thread: a counting pass sizes the arrays, a second one fills them.
+// The mesh is centered on the origin, its largest half extent brought to 1: the
+// radius of the system scales it like the other shapes.
+// Volume: MESH_COLUMNS x MESH_COLUMNS columns along z over [-1, 1], cut into the
+// spans inside the mesh by ray parity. Exact for any closed mesh up to the width
+// of a column.
+
+#define MESH_CHUNK			(std::size_t(4) << 20)	// bytes of the file per parser task
+#define MESH_COLUMNS		256						// volume: columns per axis
+
+struct Mesh {
+	std::vector<float>	triangles;		// 9 floats per triangle, the layout of the device buffer
+	std::vector<float>	surfaceCdf;		// running area, normalized, one per triangle
+	std::vector<float>	spans;			// volume: 6 floats per inside span, x0 y0 x1 y1 z0 z1
+	std::vector<float>	spanCdf;		// running volume of the spans, normalized
+	size_t				vertices = 0;
+};
+
+bool isObjPath(const std::string &path);
+void readObj(const std::string &path, Mesh &mesh);		// throws fileError
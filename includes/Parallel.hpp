@@ -0,0 +1,39 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Parallel.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 10:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 10:14:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Runs fn(i) for i in [0, n) on every hardware thread, i is handed out round robin
+// Used for host side work that is split in independent chunks (codec, file loaders)
+template <typename Fn>
+void parallelFor(size_t n, Fn fn) {
+	size_t nThreads = std::max(1u, std::thread::hardware_concurrency());
+	nThreads = std::min(nThreads, n);
+	if (nThreads <= 1) {
+		for (size_t i = 0; i < n; ++i) fn(i);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(nThreads);
+	for (size_t t = 0; t < nThreads; ++t) {
+		workers.emplace_back([=, &fn]() {
+			for (size_t i = t; i < n; i += nThreads) fn(i);
+		});
+	}
+	for (auto &w : workers) w.join();
+}
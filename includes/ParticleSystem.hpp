@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/12/17 15:40:34 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/18 17:46:06 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 02:09:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -33,14 +33,20 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
 #include "Exception.hpp"
+#include "ClDevices.hpp"
+#include "GlExtensions.hpp"
+#include "ResourcePool.hpp"
+#include "DeviceArena.hpp"
+#include "GlCompute.hpp"
 
 
 struct GravityPoint {
 	float _Mass;
 	cl_float4 _Position;
 	uint32_t _active; // 1 active, -1 inactive
-	int _type; // 0 gravity, 1 Lorentz, 2 Curl noise, 3 repulsion
+	int _type; // 0 gravity, 1 Lorentz, 2 Curl noise, 3 repulsion, 4 vector field
 
 	GravityPoint();
 	GravityPoint(float x, float y, float z, float w, float m)
@@ -62,28 +68,208 @@ struct GravityPoint {
 };
 
 
+// Live statistics reduced on the device (reduceStats in kernels.cl)
+#define STATS_GROUPS	64
+#define STATS_WG		128
+#define STATS_BINS		32
+#define STATS_MAX_GP	8
+#define STATS_MAX_SPEED	15.0f		// MAX_SPEED of updateSpace, range of the histogram
+
+#define CULL_WG			128			// cullFrustum in kernels.cl
+
+// Render level of detail
+#define LOD_POINT_SIZE		2.0f		// pixels, every particle drawn
+#define LOD_MAX_POINT		16.0f
+#define LOD_MIN_FRACTION	(1.0f / 64.0f)
+
+// Depth sort of the visible particles (radix sort in kernels.cl)
+#define SORT_WG				128
+#define SORT_ITEMS			16
+#define SORT_RADIX			16			// 4 bits per pass
+#define SORT_APPROX_FRAMES	4			// approximate mode: 8 bit keys, sorted every 4 frames
+
+// Motion trails (recordTrails in kernels.cl, drawn by TrailRenderer)
+#define TRAIL_MAX_COUNT		16384
+#define TRAIL_MAX_LENGTH	256
+
+#define HOST_RING			3			// host written buffers: slots of the persistent mapping
+#define HOST_COPY_CHUNK		(std::size_t(1) << 20)	// bytes per worker task of the copy
+
+// Baked turbulence (bakeCurlNoise in kernels.cl): two tileable curl noise volumes
+// sampled by the type 2 sources instead of evaluating curlNoise
+#define NOISE_SIZE			64			// texels per side, float4
+#define NOISE_BLEND_RATE	0.15f		// rad/s of the blend between the two volumes
+#define NOISE_SCROLL		0.01f		// tiles/s along the diagonal
+
+// Baked force field (bakeForceField in kernels.cl): summed gravity and repulsion
+// on a grid around the cloud, rebaked when the sources change or the cloud leaves it
+#define FIELD_SIZE			64			// texels per side, mirror of kernels.cl
+#define FIELD_MARGIN		0.25f		// of the cloud extent, on each side
+
+#define GL_COMPUTE_LABEL	"OpenGL compute shaders"	// device request of the UI for the GL backend
+
+#define SIM_MAX_STEPS		4			// fixed step: at most that many per frame, the rest is dropped
+
+// Mirror of struct StatsPartial in kernels.cl, one per work-group
+struct StatsPartial {
+	float	bmin[4];
+	float	bmax[4];
+	float	sum[4];			// xyz: sum of positions, w: sum of |p|^2
+	float	kinetic;
+	float	potential;
+	float	maxSpeed;
+	float	count;
+	cl_uint	hist[STATS_BINS];
+	cl_uint	captured[STATS_MAX_GP];
+};
+
+// Folded on the host from STATS_GROUPS partials, one frame late
+struct SimStats {
+	bool		valid = false;
+	glm::vec3	bmin = glm::vec3(0.0f);
+	glm::vec3	bmax = glm::vec3(0.0f);
+	glm::vec3	center = glm::vec3(0.0f);		// center of mass
+	float		spread = 0.0f;					// RMS distance to the center
+	float		kinetic = 0.0f;
+	float		potential = 0.0f;
+	float		maxSpeed = 0.0f;
+	float		speedP95 = 0.0f;
+	float		hist[STATS_BINS] = {};
+	unsigned	captured[STATS_MAX_GP] = {};
+};
+
+// Split mode: one slice of the particle range on its own device or NUMA node
+struct Partition {
+	std::string			label;
+	cl_device_id		device = nullptr;
+	cl_command_queue	queue = nullptr;	// owned by the pool
+	cl_uint				weight = 1;			// compute units, sizes the slice
+	size_t				offset = 0;			// first particle
+	size_t				count = 0;
+	ClMem				pos;				// sub-buffers of the full buffers
+	ClMem				vel;
+	ClMem				col;
+	ClMem				gravity;			// own copy of the gravity sources
+};
+
+struct StreamState;		// Streaming.hpp
+
+
 class ParticleSystem {
 	public:
-		ParticleSystem(size_t, const std::string&);
+		// backend: "cl", "gl" (compute shaders), empty: OpenCL unless it can't share the GL buffers
+		ParticleSystem(size_t, const std::string&, const std::string &device = "", const std::string &split = "",
+			const std::string &backend = "");
 		~ParticleSystem();
 		
 		ParticleSystem(const ParticleSystem &other) = delete;
 		ParticleSystem &operator=(const ParticleSystem &other) = delete;
 
+		void createContext(const std::string &device, const std::string &split);
+		void selectBackend(const std::string &device, const std::string &split, const std::string &backend);
+		void createArena();
 		void createBuffers();
 		void releaseBuffers();
 		void registerInterop();
 		void createKernel();
 		void setKernel(const std::string &);
-		void initializeShape(const std::string &);
+		void initializeShape(const std::string &);		// sphere, cube, pyramid, mesh, volume, image, relief
+
+		// Mesh shapes (Mesh.hpp): "mesh" samples the surface, "volume" the inside
+		void loadMesh(const std::string &path);
+		bool hasMesh() const { return _meshTriangleCount != 0; };
+		cl_uint getMeshTriangles() const { return _meshTriangleCount; };
+		float getMeshLoadMs() const { return _meshLoadMs; };
+		const std::string& getMeshPath() const { return _meshPath; };
+
+		// Image shapes (Picture.hpp): "image" on a plane, "relief" raised by the luminance
+		void loadPicture(const std::string &path);
+		bool hasPicture() const { return _pictureWidth != 0; };
+		cl_uint getPictureWidth() const { return _pictureWidth; };
+		cl_uint getPictureHeight() const { return _pictureHeight; };
+		float getPictureLoadMs() const { return _pictureLoadMs; };
+		const std::string& getPicturePath() const { return _picturePath; };
 		
 		void setupRendering();
-		void render();
+		void beginFrame();						// kernel scratch of the previous frame is free again
+		void render(bool additive = false);		// additive: HDR splatting, see HdrRenderer
+
+		// Frustum culling into an indirect draw, needs GL sharing and GL 4.0
+		void cull(const glm::mat4 &mvp);
+		bool canCull() const { return _clIndexBuffer.get() != nullptr; };
+		bool& cullEnabled() { return _cullEnabled; };
+
+		// Level of detail: a stratified subset, drawn bigger and fainter. Culling pass only
+		void updateLod(const glm::mat4 &mvp, int width, int height, float frameTime);
+		int& getLodMode() { return _lodMode; };
+		float& lodDensity() { return _lodDensity; };
+		float& lodTargetMs() { return _lodTargetMs; };
+		float getLodFraction() const { return _lodFraction; };
+		float getPointSize() const { return _pointSize; };
+		float getPointAlpha() const { return _pointAlpha; };
+		float& basePointSize() { return _basePointSize; };
+
+		// Translucent sprites, drawn back to front when sorting is on
+		bool& softSprites() { return _softSprites; };
+		int& getSortMode() { return _sortMode; };
+		bool isTranslucent() const { return _softSprites || _pointAlpha < 1.0f; };
+
+		// Motion trails: ring of the last positions of every stride-th particle, on the device.
+		// Recorded by update, GL sharing only
+		void setTrails(int count, int length);		// count 0: off
+		bool canTrail() const { return _interop; };
+		bool trailsLive() const { return _trailCount && _trailFrame == _frameIndex; };
+		int getTrailCount() const { return _trailCount; };
+		int getTrailLength() const { return _trailLength; };
+		GLsizei trailsDrawn() const { return static_cast<GLsizei>(std::min<size_t>(_trailCount, _nbParticle)); };
+		cl_uint getTrailHead() const { return _trailHead; };
+		cl_uint getTrailStride() const { return _trailStride; };
+		float getTrailAlpha() const { return _trailAlpha; };
+		float& trailAlpha() { return _trailAlpha; };
+		GLuint trailBuffer() const { return _trailBuffer; };
+
+		// Turbulence from the baked volumes, OpenCL devices with image support only
+		bool hasNoiseVolume() const { return _noiseA.get() != nullptr; };
+		bool& bakedNoise() { return _bakedNoise; };
+
+		// Static sources read from a baked grid inside its box, one fetch whatever their number
+		bool hasForceField() const { return _fieldImages; };
+		bool& forceField() { return _forceField; };
+		bool fieldLive() const { return _forceField && _fieldImage.get() && !_fieldStale; };
+		float getFieldMaxError() const { return _fieldMaxError; };
+		float getFieldMeanError() const { return _fieldMeanError; };
+		unsigned getFieldBakes() const { return _fieldBakes; };
+
+		// Imported vector field (VectorField.hpp), placed by every type 4 source, mass as strength
+		void loadVectorField(const std::string &path);
+		bool hasVectorField() const { return _vfieldImage.get() != nullptr; };
+		const std::string& getVectorFieldPath() const { return _vfieldPath; };
+		const cl_uint* getVectorFieldSize() const { return _vfieldSize; };
+		float& vectorFieldScale() { return _vfieldScale; };
+		float& vectorFieldFalloff() { return _vfieldFalloff; };
 
+		// Around every CL access to pos/vel/col: GL sharing, or copy back when written
 		void acquireGLObjects();
-		void releaseGLObjects();
+		void releaseGLObjects(bool written = true);
 		void update(float dt);
 
+		// Fixed step: the simulation ticks at stepRate, the display blends the
+		// positions before and after the last step. 0: one step per frame
+		int& stepRate() { return _stepRate; };
+		void keepPrevious();					// before the last step of a frame
+		float interpolation(float alpha) const { return _prevValid ? alpha : 1.0f; };
+
+		// Host writes straight into the rendered positions (trajectory playback)
+		cl_float4* mapPositions();
+		void unmapPositions();
+
+		const ClDeviceInfo& getDevice() const { return _device; };
+		bool isInterop() const { return _interop; };
+		bool isGlCompute() const { return _compute != nullptr; };
+		const std::vector<Partition>& getPartitions() const { return _partitions; };
+		const ResourcePool& getPool() const { return _pool; };
+		const DeviceArena& getArena() const { return _arena; };
+
 		GLuint posBuffer() const { return _posBuffer; };
 		GLuint velBuffer() const { return _velBuffer; };
 		GLuint colBuffer() const { return _colorBuffer; };
@@ -101,11 +287,38 @@ class ParticleSystem {
 		void setType(int);
 
 		size_t getNPart() const { return _nbParticle; };
-		void setNbPart(int);
+		float getTime() const { return _time; };
+		cl_event readPositions(cl_float4* dst);	// copy of the N positions, done when the event is (null: already done)
+		void setNbPart(int);					// keeps the state, appends new particles
+		size_t getCapacity() const { return _capacity; };
 
 		int& getColorMode() { return _colorMode; };
 		void setColorMode(int mode) { _colorMode = mode; };
 
+		const SimStats& getStats() const { return _stats; };
+		bool& autoSpeedScale() { return _autoSpeedScale; };
+		float getSpeedScale() const { return _speedScale; };
+
+		uint32_t getSeed() const { return _seed; };
+		void setSeed(uint32_t seed) { _seed = seed; };
+
+		// Binary snapshot, see Snapshot.hpp
+		void saveSnapshot(const std::string &);
+		void loadSnapshot(const std::string &);
+
+		// Point cloud as the starting state, see PointCloud.hpp. fitRadius 0: coordinates kept
+		void loadPointCloud(const std::string &path, int rawStride = 3, float fitRadius = 0.0f);
+		bool hasLoadedColors() const { return hasPicture() || _cloudColors; };
+		float getCloudLoadMs() const { return _cloudLoadMs; };
+		const std::string& getCloudPath() const { return _cloudPath; };
+
+		// Out-of-core mode, see Streaming.hpp. Replaces update while active.
+		void startStreaming(const std::string &path, uint64_t count);	// count 0: resume the file
+		void stopStreaming();
+		void streamStep(float dt);
+		bool isStreaming() const { return _stream != nullptr; };
+		const StreamState* getStream() const { return _stream.get(); };
+
 		void addGravityPoint(float, float, float, float, bool, int);
 		void removeGravityPoint(int);
 		
@@ -113,33 +326,189 @@ class ParticleSystem {
 		void updatePositionGP(int, float, float, float, float);
 		
 	private:
-		int _shape; // 0 sphere, 1 cube, 2 pyramid
+		int _shape; // 0 sphere, 1 cube, 2 pyramid, 3 mesh surface, 4 mesh volume
 		size_t _nbParticle;
+		size_t _capacity;				// particles the buffers can hold, grows geometrically
 		float _radius;
 		int _gravityEnable = 0;
 		int _nGravityPos = 0;
 		int _colorMode = 0;
 		int _speed = 0;
 		float _time = 0.0f;
+		uint32_t _seed = 0;
 
 		std::vector<GravityPoint> _GravityCenter;
 
+		// Statistics: read back without blocking, collected when the event completes
+		SimStats _stats;
+		std::vector<StatsPartial> _statsPartials;
+		cl_event _statsEvent = nullptr;
+		bool _autoSpeedScale = false;
+		float _speedScale = 7.0f;		// speed giving the hottest color
+
+		void enqueueStats(cl_uint nGravityPoints);
+		void collectStats();
+
+		// Device, and how its results reach OpenGL
+		ClDeviceInfo _device;
+		bool _interop = true;			// false: CL buffers of its own, mapped and copied each frame
+		// Host written buffers (copy path, playback): HOST_RING slots of the capacity
+		// in each persistently mapped buffer. The host fills the next slot while GL
+		// still draws the previous ones, a slot is reused once the fence of the last
+		// draw reading it has passed
+		char* _posMapped = nullptr;		// whole ring, null without GL_ARB_buffer_storage
+		char* _colMapped = nullptr;
+		int _hostSlot = 0;				// slot the draws read
+		int _mappedSlot = 0;			// handed out by mapPositions
+		GLsync _slotFence[HOST_RING] = {};
+
+		size_t slotOffset(int slot) const { return slot * _capacity * sizeof(cl_float4); };
+		int nextHostSlot();				// waits on its fence, normally long passed
+		void bindHostSlot(int slot);	// the draws read it from now on
+		void fenceHostSlot();			// after a GL command reading the current slot
+		void copyToGL();
+		void waitDrawFences();
+
+		int _stepRate = 0;
+		bool _prevValid = false;		// _prevBuffer holds the positions of the previous step
+
+		// GL compute backend, null with OpenCL: no context, no CL buffer, no kernel
+		std::unique_ptr<GlCompute> _compute;
+		void dropOpenCl();
+
+		std::unique_ptr<StreamState> _stream;
+		void streamInit();
+
+		// Culling: visible indices and the draw command, written by cullFrustum
+		bool _cullEnabled = true;
+		bool _culled = false;			// the next render draws through the indirect command
+		int _lodMode = 0;				// 0 off, 1 projected size, 2 frame time
+		float _lodDensity = 2.0f;		// particles per covered pixel
+		float _lodTargetMs = 16.7f;
+		float _lodFraction = 1.0f;
+		float _basePointSize = LOD_POINT_SIZE;
+		float _pointSize = LOD_POINT_SIZE;
+		float _pointAlpha = 1.0f;
+		bool _softSprites = false;
+		int _sortMode = 1;				// 0 off, 1 exact, 2 approximate
+		unsigned _sortFrame = 0;
+		cl_uint _sortedCount = 0;		// approximate mode: list kept while the count doesn't change
+		void sortVisible(const glm::mat4 &mvp, cl_uint bound);
+		void createCullBuffers();
+		GLsizei drawCount() const;
+
+		// Trails: _trailHead is the frame counter of the ring, a gap in the
+		// recorded frames (streaming, playback) or a new stride refills it
+		unsigned _frameIndex = 0;
+		unsigned _trailFrame = 0;		// frame of the last record
+		int _trailCount = 0;
+		int _trailLength = 64;
+		cl_uint _trailHead = 0;			// slot written last
+		cl_uint _trailStride = 0;		// particles between two trails, 0: refill
+		float _trailAlpha = 0.6f;
+		void recordTrails();
+
+		// Baked with the program when every device of the context supports images
+		ClMem _noiseA;
+		ClMem _noiseB;
+		bool _bakedNoise = true;
+		void bakeNoise();
+		cl_int setVolumeArgs(float time);		// arguments 10.. of updateSpace
+
+		// Force field, over [_fieldMin, _fieldMax]. Stale: the sources changed since the bake
+		bool _fieldImages = false;		// program built with FORCE_FIELD
+		bool _forceField = false;
+		bool _fieldStale = true;
+		ClMem _fieldImage;
+		glm::vec3 _fieldMin = glm::vec3(0.0f);
+		glm::vec3 _fieldMax = glm::vec3(0.0f);
+		std::vector<GravityPoint> _fieldSources;	// as baked
+		float _fieldMaxError = 0.0f;	// relative, at the cell centers away from the sources
+		float _fieldMeanError = 0.0f;
+		unsigned _fieldBakes = 0;
+		void refreshField();
+		void bakeField(const glm::vec3 &bmin, const glm::vec3 &bmax);
+
+		// Imported field: box of its texels in field space, scaled into the world
+		ClMem _vfieldImage;
+		cl_uint _vfieldSize[3] = {0, 0, 0};
+		glm::vec3 _vfieldMin = glm::vec3(0.0f);
+		glm::vec3 _vfieldMax = glm::vec3(0.0f);
+		std::string _vfieldPath;
+		float _vfieldScale = 1.0f;		// world units per field unit
+		float _vfieldFalloff = 0.0f;	// distance to the source where it fades out, 0: none
+
+		void reallocate(size_t capacity);
+		void initializeRange(size_t first);
+		int shapeFlag(const std::string &shape) const;		// mesh and image shapes fall back to the sphere without their data
+		static const char* shapeName(int flag);
+
+		// Loaded mesh: 9 floats per triangle and running area for initShape
+		ClMem _meshTriangles;
+		ClMem _meshSurfaceCdf;
+		ClMem _meshSpans;				// inside spans for the volume, see Mesh.hpp
+		ClMem _meshSpanCdf;
+		cl_uint _meshTriangleCount = 0;
+		cl_uint _meshSpanCount = 0;		// 0: open mesh, "volume" samples the surface
+		std::string _meshPath;
+		float _meshLoadMs = 0.0f;
+
+		// Loaded picture: RGBA8 image, a 1x1 placeholder until then, and its luminance tables
+		ClMem _picture;
+		ClMem _pictureRows;
+		ClMem _picturePixels;
+		cl_uint _pictureWidth = 0;
+		cl_uint _pictureHeight = 0;
+		std::string _picturePath;
+		float _pictureLoadMs = 0.0f;
+
+		// Last point cloud: whether it brought colors, shown by the loaded colors mode
+		bool _cloudColors = false;
+		std::string _cloudPath;
+		float _cloudLoadMs = 0.0f;
+
+		// Split mode (--split), empty otherwise
+		std::vector<Partition> _partitions;
+		std::vector<cl_device_id> _contextDevices;	// every device of _clContext
+		std::vector<cl_device_id> _subDevices;		// created by us, released with the context
+
+		void createSplitContext(const std::vector<ClDeviceInfo> &, const std::string &split);
+		void createPartitionBuffers();
+		void migratePartitions();
+		void launchPartitions();
+
 		// OpenGl
-		GLuint _posBuffer;
-		GLuint _velBuffer;
-		GLuint _colorBuffer;
-		GLuint _vao;
+		GlBuffer _posBuffer;
+		GlBuffer _prevBuffer;			// vertex attribute 2, copied by keepPrevious
+		GlBuffer _velBuffer;
+		GlBuffer _colorBuffer;
+		GlBuffer _indexBuffer;
+		GlBuffer _indirectBuffer;
+		GlBuffer _trailBuffer;
+		GLuint _vao = 0;
 		
-		// OpenCl
-		cl_context _clContext;
-		cl_command_queue _clQueue;
-		cl_program _clProgram;
+		// OpenCl, declared in release order: the pool before the program and the context
+		ClContext _clContext;
+		ClProgram _clProgram;
+		ResourcePool _pool;
+		cl_command_queue _clQueue = nullptr;	// queues and kernels are owned by the pool
+		DeviceArena _arena;						// small buffers and per-frame scratch of the kernels
+		int _gravityRegion = -1;
 			// memory
-		cl_mem _clPosBuffer;
-		cl_mem _clVelBuffer;
-		cl_mem _clColBuffer;
-		cl_mem _clGravityBuffer = nullptr;
+		ClMem _clPosBuffer;
+		ClMem _clVelBuffer;
+		ClMem _clColBuffer;
+		ClMem _clIndexBuffer;
+		ClMem _clIndirectBuffer;
+		ClMem _clTrailBuffer;
 			// kernel
-		cl_kernel _initShape;
-		cl_kernel _updateSys;
+		cl_kernel _initShape = nullptr;
+		cl_kernel _updateSys = nullptr;
+		cl_kernel _reduceStats = nullptr;
+		cl_kernel _cullFrustum = nullptr;
+		cl_kernel _sortKeys = nullptr;
+		cl_kernel _radixHistogram = nullptr;
+		cl_kernel _radixScan = nullptr;
+		cl_kernel _radixScatter = nullptr;
+		cl_kernel _recordTrails = nullptr;
 };
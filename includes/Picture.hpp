@@ -0,0 +1,36 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Picture.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 23:49:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 23:59:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Image shapes of initShape: particles emitted at pixel positions with the pixel
+// colors, their density following the luminance. Decoded by stb_image from a
+// mapping of the file, uploaded once as an RGBA8 image with the two tables of
+// the importance sampling:
+//   rowCdf:   running luminance of the rows, normalized (height floats)
+//   pixelCdf: running luminance inside each row, normalized per row (width * height)
+
+#define PICTURE_RELIEF		0.5f		// relief: height of a white pixel, in radius (mirror of kernels.cl)
+
+struct Picture {
+	int						width = 0;
+	int						height = 0;
+	std::vector<unsigned char>	rgba;		// top row first
+	std::vector<float>		rowCdf;
+	std::vector<float>		pixelCdf;
+};
+
+bool isPicturePath(const std::string &path);			// png, jpg, bmp, tga...
+void readPicture(const std::string &path, Picture &picture);	// throws fileError
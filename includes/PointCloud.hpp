@@ -0,0 +1,74 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   PointCloud.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 00:34:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:39:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include <CL/cl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "glm/glm.hpp"
+
+// Point clouds as a starting state: LiDAR scans, output of other simulations.
+//
+// .ply, binary little or big endian: the vertex element with x y z, optional
+//   red green blue [alpha] and vx vy vz, any scalar type; other properties skipped
+// anything else: headerless float32 records of
+//   3  x y z
+//   4  x y z w, w ignored: the position buffer needs w = 1
+//   6  x y z r g b
+//   9  x y z r g b vx vy vz
+// Records are decoded from the mapping straight into the mapped device buffers,
+// one chunk at a time: nothing is staged in a std::vector.
+
+#define CLOUD_CHUNK		(std::size_t(1) << 20)	// particles per mapped chunk
+#define CLOUD_TASK		16384					// particles per host task
+
+enum CloudType : uint8_t { CLOUD_I8, CLOUD_U8, CLOUD_I16, CLOUD_U16, CLOUD_I32, CLOUD_U32, CLOUD_F32, CLOUD_F64 };
+
+struct CloudAttr {
+	int32_t		offset = -1;		// in the record, -1: absent
+	CloudType	type = CLOUD_F32;
+};
+
+struct CloudLayout {
+	uint64_t	count = 0;
+	uint64_t	start = 0;			// first record, from the start of the file
+	uint32_t	stride = 0;			// bytes per record
+	bool		swap = false;		// big endian file
+	bool		raw = false;
+	CloudAttr	pos[3];
+	CloudAttr	col[4];
+	CloudAttr	vel[3];
+
+	bool hasColors() const { return col[0].offset >= 0; };
+	bool hasVelocities() const { return vel[0].offset >= 0; };
+};
+
+// Applied in double: coordinates far from the origin keep their precision
+struct CloudTransform {
+	glm::dvec3	center = glm::dvec3(0.0);
+	double		scale = 1.0;
+};
+
+bool isPlyPath(const std::string &path);
+// .ply header, or the record size of a raw file. Throws fileError
+void readCloudLayout(const std::string &path, const unsigned char* data, size_t size, int rawStride, CloudLayout &layout);
+// Box of the positions, one task per CLOUD_TASK records
+void cloudBounds(const unsigned char* data, const CloudLayout &layout, glm::dvec3 &bmin, glm::dvec3 &bmax);
+// Records [first, first + n), absent attributes get white and zero. A null array is skipped
+void decodeCloud(const unsigned char* data, const CloudLayout &layout, const CloudTransform &transform,
+	size_t first, size_t n, cl_float4* pos, cl_float4* col, cl_float4* vel);
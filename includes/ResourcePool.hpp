@@ -0,0 +1,59 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResourcePool.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 15:19:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 15:54:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "Resources.hpp"
+#include "Exception.hpp"
+
+#define POOL_MAX_BYTES		(256ull << 20)		// recycled buffers kept beyond that go back to the driver
+
+// Per context: kernels created once by name, queues by device and role,
+// buffers recycled by (flags, size) instead of going back to the driver.
+// Must be cleared before its context is released.
+class ResourcePool {
+	public:
+		ResourcePool();
+		~ResourcePool();
+
+		ResourcePool(const ResourcePool &other) = delete;
+		ResourcePool &operator=(const ResourcePool &other) = delete;
+
+		void setContext(cl_context context) { _context = context; };
+		void setProgram(cl_program program) { _program = program; };
+
+		cl_kernel kernel(const std::string &name);
+		cl_command_queue queue(cl_device_id device, const std::string &role = "main");
+
+		// A free buffer of exactly that size and flags, or a new one
+		ClMem buffer(cl_mem_flags flags, size_t size);
+		// Back to the free list: nothing may still be queued on it
+		void recycle(ClMem &buffer);
+
+		void trim();		// free list back to the driver
+		void clear();		// everything, kernels and queues too
+
+		size_t pooledBuffers() const { return _free.size(); };
+		size_t pooledBytes() const { return _pooledBytes; };
+
+	private:
+		cl_context	_context;
+		cl_program	_program;
+		std::map<std::string, ClKernel>								_kernels;
+		std::map<std::pair<cl_device_id, std::string>, ClQueue>		_queues;
+		std::multimap<std::pair<cl_mem_flags, size_t>, ClMem>		_free;
+		size_t		_pooledBytes;
+};
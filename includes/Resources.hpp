@@ -0,0 +1,126 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Resources.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 15:09:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 15:59:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include <glad/glad.h>
+#include <CL/cl.h>
+
+#include <atomic>
+#include <cstddef>
+
+// Live objects held on the devices, shown in the UI.
+// GL buffers shared with OpenCL count on both sides.
+struct ResourceCounters {
+	std::atomic<long>		contexts{0};
+	std::atomic<long>		programs{0};
+	std::atomic<long>		queues{0};
+	std::atomic<long>		kernels{0};
+	std::atomic<long>		buffers{0};
+	std::atomic<long long>	bufferBytes{0};		// sub-buffers excluded, they alias their parent
+	std::atomic<long>		glBuffers{0};
+	std::atomic<long long>	glBufferBytes{0};
+};
+
+ResourceCounters& resourceCounters();
+
+// Release call and counter of each OpenCL object type
+template<typename T> struct ClTraits;
+
+template<> struct ClTraits<cl_context> {
+	static void adopt(cl_context) { resourceCounters().contexts++; };
+	static void drop(cl_context h) { resourceCounters().contexts--; clReleaseContext(h); };
+};
+template<> struct ClTraits<cl_program> {
+	static void adopt(cl_program) { resourceCounters().programs++; };
+	static void drop(cl_program h) { resourceCounters().programs--; clReleaseProgram(h); };
+};
+template<> struct ClTraits<cl_command_queue> {
+	static void adopt(cl_command_queue) { resourceCounters().queues++; };
+	static void drop(cl_command_queue h) { resourceCounters().queues--; clReleaseCommandQueue(h); };
+};
+template<> struct ClTraits<cl_kernel> {
+	static void adopt(cl_kernel) { resourceCounters().kernels++; };
+	static void drop(cl_kernel h) { resourceCounters().kernels--; clReleaseKernel(h); };
+};
+template<> struct ClTraits<cl_mem> {
+	static void adopt(cl_mem);
+	static void drop(cl_mem);
+};
+
+// Owns one reference to an OpenCL object, released with the handle.
+// Converts to the raw type for the cl* calls; addr() for clSetKernelArg.
+template<typename T>
+class ClHandle {
+	public:
+		ClHandle(): _handle(nullptr) {};
+		explicit ClHandle(T handle): _handle(nullptr) { reset(handle); };
+		~ClHandle() { reset(); };
+
+		ClHandle(const ClHandle &other) = delete;
+		ClHandle &operator=(const ClHandle &other) = delete;
+
+		ClHandle(ClHandle &&other) noexcept: _handle(other._handle) { other._handle = nullptr; };
+		ClHandle &operator=(ClHandle &&other) noexcept {
+			if (this != &other) {
+				reset();
+				_handle = other._handle;
+				other._handle = nullptr;
+			}
+			return *this;
+		};
+
+		// Takes ownership of handle (null: just releases)
+		void reset(T handle = nullptr) {
+			if (_handle) ClTraits<T>::drop(_handle);
+			_handle = handle;
+			if (_handle) ClTraits<T>::adopt(_handle);
+		};
+
+		T get() const { return _handle; };
+		const T* addr() const { return &_handle; };
+		operator T() const { return _handle; };
+
+	private:
+		T _handle;
+};
+
+typedef ClHandle<cl_context>		ClContext;
+typedef ClHandle<cl_program>		ClProgram;
+typedef ClHandle<cl_command_queue>	ClQueue;
+typedef ClHandle<cl_kernel>			ClKernel;
+typedef ClHandle<cl_mem>			ClMem;
+
+// OpenGL buffer object, deleted with its owner (the GL context must still be current)
+class GlBuffer {
+	public:
+		GlBuffer(): _id(0), _bytes(0) {};
+		~GlBuffer() { reset(); };
+
+		GlBuffer(const GlBuffer &other) = delete;
+		GlBuffer &operator=(const GlBuffer &other) = delete;
+
+		GlBuffer(GlBuffer &&other) noexcept: _id(other._id), _bytes(other._bytes) { other._id = 0; other._bytes = 0; };
+		GlBuffer &operator=(GlBuffer &&other) noexcept;
+
+		void create(size_t bytes);		// glGenBuffers, the storage is allocated by the caller
+		void reset();
+
+		GLuint id() const { return _id; };
+		operator GLuint() const { return _id; };
+
+	private:
+		GLuint	_id;
+		size_t	_bytes;
+};
@@ -0,0 +1,55 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Snapshot.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 09:24:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 09:24:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Binary snapshot of a whole ParticleSystem (.psnap)
+//
+//   [ SnapshotHeader | GravityPoint[nGravity] ] [ pos ] [ vel ] [ col ]
+//
+// Every attribute block starts on a page boundary and holds nbParticle float4,
+// exactly like the device buffers: a mapped file is uploaded with one
+// clEnqueueWriteBuffer per attribute, no parsing pass.
+// Fixed width fields only: a snapshot is portable between x86_64 machines.
+
+#define SNAPSHOT_MAGIC		"PSYSSNAP"
+#define SNAPSHOT_VERSION	1u
+#define SNAPSHOT_ALIGN		4096u
+
+struct SnapshotHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	headerSize;		// sizeof(SnapshotHeader), catches layout changes
+	uint64_t	fileSize;
+	uint64_t	nbParticle;
+
+	int32_t		shape;			// 0 sphere, 1 cube, 2 pyramid
+	int32_t		speed;			// speed mode given to initShape
+	int32_t		colorMode;
+	int32_t		gravityEnable;
+	float		time;
+	float		radius;
+	uint32_t	seed;			// RNG seed of initShape
+	uint32_t	nGravity;
+
+	uint64_t	gravityOffset;	// byte offsets from the start of the file
+	uint64_t	posOffset;
+	uint64_t	velOffset;
+	uint64_t	colOffset;
+};
+
+inline uint64_t snapshotAlign(uint64_t offset) {
+	return (offset + SNAPSHOT_ALIGN - 1) & ~static_cast<uint64_t>(SNAPSHOT_ALIGN - 1);
+}
@@ -0,0 +1,75 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Streaming.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 14:09:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 15:34:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include <CL/cl.h>
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.hpp"
+#include "Resources.hpp"
+
+// Out-of-core simulation: the state of every particle lives in a mapped file,
+// fixed-size chunks go through the device with the next upload overlapping
+// the current kernel. Only a decimated subset reaches the GL buffers.
+//
+// File layout (.pstream), blocks aligned on STREAM_ALIGN:
+//   StreamHeader | positions (float4 * N) | velocities (float4 * N)
+
+#define STREAM_MAGIC		"PSYSSTRM"
+#define STREAM_VERSION		1
+#define STREAM_ALIGN		4096
+#define STREAM_CHUNK		(1u << 21)		// particles per chunk: 3 x 32 MB on the device per slot
+#define STREAM_MAX			4000000000ull	// indices stay in a uint on the device
+#define STREAM_FRAME_MS		25.0			// chunk budget of a frame
+
+struct StreamHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint64_t	nbParticle;
+	uint64_t	posOffset;
+	uint64_t	velOffset;
+	int32_t		shape;
+	uint32_t	seed;
+	uint32_t	steps;		// completed passes
+	float		time;
+	float		radius;
+	uint32_t	speed;
+};
+
+struct StreamState {
+	~StreamState();		// waits for the io queue, the chunk buffers release themselves
+
+	std::string			path;
+	MappedFile			file;
+	StreamHeader		header;
+	size_t				nChunks = 0;
+	size_t				stride = 1;			// one rendered particle every stride
+	size_t				nRendered = 0;
+
+	cl_command_queue	io = nullptr;		// uploads and downloads, the main queue computes (pool)
+	cl_kernel			decimate = nullptr;	// pool
+	ClMem				pos[2];				// double buffered chunks
+	ClMem				vel[2];
+	ClMem				col[2];
+
+	size_t				next = 0;			// next chunk of the current pass
+	float				passDt = 0.0f;
+	size_t				chunksPerFrame = 1;
+	double				passStart = 0.0;
+	double				lastPass = 0.0;		// seconds for the last full pass
+};
@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TrailRenderer.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 19:24:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 19:24:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include "Exception.hpp"
+#include "ParticleSystem.hpp"
+
+// Motion trails: one line strip per trail, vertex-pulled from the device ring
+// written by recordTrails through texture buffers. No attribute, no copy:
+// the oldest slot follows the head, alpha fades with the age.
+class TrailRenderer {
+	public:
+		TrailRenderer();
+		~TrailRenderer();
+
+		TrailRenderer(const TrailRenderer &other) = delete;
+		TrailRenderer &operator=(const TrailRenderer &other) = delete;
+
+		void init();					// shaders, once the GL context is current
+		void cleanup();
+
+		// After the particles, in the same target. weight: HDR gain when additive
+		void render(const ParticleSystem &, bool additive, float weight);
+
+	private:
+		GLuint	_program;
+		GLuint	_vao;					// empty, everything comes from the texture buffers
+		GLuint	_trailTex;				// RGBA32F over the ring
+		GLuint	_colorTex;				// RGBA32F over the particle colors
+		GLint	_lengthLoc;
+		GLint	_headLoc;
+		GLint	_strideLoc;
+		GLint	_alphaLoc;
+};
@@ -0,0 +1,172 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Trajectory.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 10:19:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 10:19:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParticleSystem.hpp"
+#include "MappedFile.hpp"
+
+// Compressed trajectory (.ptraj)
+//
+//   [ TrajectoryHeader ] [ frame 0 ] ... [ frame n-1 ] [ TrajectoryIndexEntry[n] ] [ TrajectoryFooter ]
+//
+// A frame is the particle positions quantized on 16 bits per axis inside a grid.
+// Keyframes store the difference with the previous particle, other frames the
+// difference with the same particle in the previous frame. Residuals are
+// zigzag + Rice coded by blocks of TRAJ_BLOCK values, k chosen per block.
+// Frames are cut in chunks of chunkSize particles coded independently, so both
+// sides run on every core. The grid only changes on keyframes: a keyframe is
+// forced when the cloud leaves it or every keyInterval frames, which bounds
+// the decoding cost of a random seek.
+
+#define TRAJ_MAGIC			"PSYSTRAJ"
+#define TRAJ_INDEX_MAGIC	"PTRJINDX"
+#define TRAJ_VERSION		1u
+#define TRAJ_CHUNK			65536u
+#define TRAJ_BLOCK			64u
+#define TRAJ_ESCAPE			24u		// unary prefix length that announces a raw value
+#define TRAJ_RAW_BITS		17u		// zigzag of a 16 bit difference
+
+struct TrajectoryHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint64_t	nbParticle;
+	uint32_t	stepInterval;	// one frame every K simulation steps
+	uint32_t	keyInterval;
+	uint32_t	chunkSize;
+	uint32_t	reserved;
+};
+
+// Followed by uint64_t chunkEnd[nChunks], offsets relative to the end of that table
+struct TrajectoryFrameHeader {
+	uint32_t	keyframe;
+	uint32_t	nChunks;
+	float		gridMin[3];
+	float		gridStep[3];
+};
+
+struct TrajectoryIndexEntry {
+	uint64_t	offset;
+	uint64_t	size;
+	float		time;
+	uint32_t	keyframe;
+};
+
+struct TrajectoryFooter {
+	uint64_t	indexOffset;
+	uint64_t	nFrames;
+	char		magic[8];
+};
+
+
+// Captures the positions every K steps, a background thread encodes and writes them
+class TrajectoryRecorder {
+	public:
+		TrajectoryRecorder();
+		~TrajectoryRecorder();
+
+		TrajectoryRecorder(const TrajectoryRecorder &other) = delete;
+		TrajectoryRecorder &operator=(const TrajectoryRecorder &other) = delete;
+
+		void start(const std::string &path, size_t nbParticle, uint32_t stepInterval, uint32_t keyInterval = 32);
+		void stop();
+		void onStep(ParticleSystem &);		// call after every ParticleSystem::update
+
+		bool isRecording() const { return _file != nullptr; };
+		size_t getFrames() const { return _framesWritten; };
+		size_t getDropped() const { return _dropped; };
+		uint64_t getBytes() const { return _bytes; };
+
+	private:
+		struct Capture {
+			std::vector<cl_float4>	pos;
+			float					time;
+			cl_event				ready = nullptr;	// pending read into pos, waited by the writer
+		};
+
+		FILE*		_file;
+		size_t		_nbParticle;
+		uint32_t	_stepInterval;
+		uint32_t	_keyInterval;
+		uint64_t	_step;
+
+		// Producer / consumer, bounded: the simulation drops a frame rather than wait for the disk
+		std::thread					_writer;
+		std::mutex					_mutex;
+		std::condition_variable		_cv;
+		std::deque<Capture>			_pending;
+		std::vector<Capture>		_free;
+		bool						_stopping;
+
+		// Writer thread state
+		std::vector<TrajectoryIndexEntry>	_index;
+		std::vector<uint16_t>				_q[3];
+		std::vector<uint16_t>				_prev[3];
+		float		_gridMin[3];
+		float		_gridStep[3];
+		bool		_hasGrid;
+		uint32_t	_sinceKey;
+		std::atomic<uint64_t>	_bytes;
+		std::atomic<size_t>		_framesWritten;
+		size_t					_dropped;
+
+		void writerLoop();
+		void encodeFrame(const Capture &);
+};
+
+
+// Maps a recording and decodes any frame straight into the GL position buffer
+class TrajectoryPlayer {
+	public:
+		TrajectoryPlayer();
+		~TrajectoryPlayer();
+
+		TrajectoryPlayer(const TrajectoryPlayer &other) = delete;
+		TrajectoryPlayer &operator=(const TrajectoryPlayer &other) = delete;
+
+		void open(const std::string &path, ParticleSystem &);
+		void close();
+		void seek(size_t frame, ParticleSystem &);
+		void update(float dt, ParticleSystem &);	// replaces ParticleSystem::update while playing
+
+		bool isOpen() const { return _file.isOpen(); };
+		bool& playing() { return _playing; };
+		float& rate() { return _rate; };
+		size_t getFrame() const { return _frame; };
+		size_t getFrameCount() const { return _index.size(); };
+		float getFrameTime(size_t frame) const { return _index[frame].time; };
+
+	private:
+		MappedFile							_file;
+		TrajectoryHeader					_header;
+		std::vector<TrajectoryIndexEntry>	_index;
+		std::vector<uint16_t>				_q[3];		// last decoded frame
+		size_t		_decoded;						// frame held in _q, SIZE_MAX if none
+		size_t		_frame;
+		float		_clock;
+		float		_rate;
+		bool		_playing;
+
+		void decodeFrame(size_t frame);
+		void upload(size_t frame, ParticleSystem &);
+};
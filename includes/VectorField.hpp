@@ -0,0 +1,42 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VectorField.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 22:29:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 22:29:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include <CL/cl.h>
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// External vector field, sampled by the type 4 sources in updateSpace.
+//
+// .fga (fluid grid ascii of the DCC tools), comma separated:
+//   nx, ny, nz, / minX, minY, minZ, / maxX, maxY, maxZ, / nx * ny * nz vectors x, y, z
+// anything else: raw float32 x, y, z triplets of a cubic grid, the side deduced
+// from the file size, one world unit per cell, centered on the origin.
+// Either way x varies fastest, the order clCreateImage expects.
+
+#define VFIELD_MAX_SIZE		512			// texels per axis
+
+struct VectorField {
+	cl_uint					size[3] = {0, 0, 0};
+	glm::vec3				bmin = glm::vec3(0.0f);		// box covered by the texels, field space
+	glm::vec3				bmax = glm::vec3(0.0f);
+	std::vector<cl_float4>	texels;						// w unused, RGBA images only
+};
+
+// Reads from a mapping of the file, throws fileError
+void readVectorField(const std::string &path, VectorField &field);
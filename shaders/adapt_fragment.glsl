@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 vUv;
+
+uniform sampler2D uLum;
+uniform float uLevel;		// last mip level, one texel
+
+out vec4 outAdapt;
+
+// Blended with the previous value (constant alpha): eye adaptation
+void main() {
+	vec2 m = textureLod(uLum, vec2(0.5), uLevel).rg;
+	outAdapt = vec4(m.g > 0.0 ? exp(m.r / m.g) : 1.0, 0.0, 0.0, 1.0);
+}
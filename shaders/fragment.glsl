@@ -1,8 +1,29 @@
 #version 430 core
 in vec4 vColor;
 
+// Per-frame data, same block as vertex.glsl
+layout (std140) uniform Frame {
+	mat4 uView;
+	mat4 uProjection;
+	mat4 uViewProj;
+	vec4 uViewport;
+	float uTime;
+	float uExposure;
+	float uPointSize;
+	float uAlpha;
+	int uSoft;			// round sprite fading out from its center
+	float uInterp;
+};
+
 out vec4 outColor;
 
 void main() {
     outColor = vColor;
+	if (uSoft != 0) {
+		vec2 d = gl_PointCoord * 2.0 - 1.0;
+		float r2 = dot(d, d);
+		if (r2 > 1.0)
+			discard;
+		outColor.a *= exp(-4.0 * r2);
+	}
 }
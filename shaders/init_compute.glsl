@@ -0,0 +1,140 @@
+#version 430 core
+
+// initShape of kernels.cl, GL compute backend: same layouts, same random streams
+layout (local_size_x = 128) in;
+
+#define PI 3.14159265358979323846
+#define GOLDEN_ANGLE 2.399963229728653
+
+struct GravityPoint {
+	float mass;
+	vec4 position;
+	uint active;
+	int type;
+};
+
+layout (std430, binding = 0) buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) buffer Velocities { vec4 velocities[]; };
+layout (std430, binding = 3) readonly buffer Gravity { GravityPoint gPoint[]; };
+
+uniform uint uNbParticles;
+uniform uint uFirst;		// particles below are kept
+uniform float uRadius;
+uniform int uShape;			// 0 sphere, 1 cube, 2 pyramid
+uniform uint uNGravity;
+uniform uint uSpeed;
+uniform uint uSeed;
+
+float hash(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return float(x) / 4294967295.0;
+}
+
+vec4 createSphere(float radius, uint gid, uint n) {
+	// Fibonacci repartition on a sphere
+	float v = (float(gid) + 0.5) / float(n);
+	float theta = GOLDEN_ANGLE * float(gid);
+	float z = 1.0 - 2.0 * v;
+	float r = sqrt(1.0 - z * z);
+	return vec4(radius * r * cos(theta), radius * r * sin(theta), radius * z, 1.0);
+}
+
+vec4 createCube(float baseCube, uint rid) {
+	float x = (hash(rid * 3u + 0u) * 2.0 - 1.0) * baseCube / 2.0;
+	float y = (hash(rid * 3u + 1u) * 2.0 - 1.0) * baseCube / 2.0;
+	float z = (hash(rid * 3u + 2u) * 2.0 - 1.0) * baseCube / 2.0;
+	return vec4(x, y, z, 1.0);
+}
+
+vec4 createPyramid(uint gid, uint n, float baseSize) {
+	uint layers = 20u;
+	uint particlesPerLayer = max(n / layers, 1u);
+	uint layer = min(gid / particlesPerLayer, layers - 1u);
+
+	// Taille du carré à cette couche
+	float size = baseSize * (1.0 - float(layer) / float(layers - 1u));
+
+	uint localIdx = gid % particlesPerLayer;
+	uint side = max(uint(sqrt(float(particlesPerLayer))), 1u);
+	float x = (float(localIdx % side) / float(side - 1u) - 0.5) * size;
+	float z = (float(localIdx / side) / float(side - 1u) - 0.5) * size;
+	float y = (float(layer) / float(layers - 1u)) * baseSize;
+	return vec4(x, y, z, 1.0);
+}
+
+vec3 getSurfaceNormal(vec3 p, int shape) {
+	if (shape == 0)
+		return normalize(p);
+	if (shape == 1) {
+		// Cube : normale = face la plus proche
+		vec3 a = abs(p);
+		if (a.x > a.y && a.x > a.z) return vec3(sign(p.x), 0.0, 0.0);
+		if (a.y > a.z) return vec3(0.0, sign(p.y), 0.0);
+		return vec3(0.0, 0.0, sign(p.z));
+	}
+	if (p.y < 0.1)
+		return vec3(0.0, -1.0, 0.0);
+	vec3 toCenter = -normalize(vec3(p.x, 0.0, p.z));
+	return normalize(vec3(toCenter.x, 0.5, toCenter.z));
+}
+
+vec4 initSpeed(vec3 pos, vec4 velocity, uint rid) {
+	if (uSpeed == 1u)
+		return vec4(0.0, 0.0, 0.0, velocity.w);
+	if (uSpeed == 2u) {
+		// Normale + composante orbitale
+		vec3 normalVel = getSurfaceNormal(pos, uShape) * (1.0 + hash(rid) * 5.0);
+		vec3 orbitalVel = vec3(0.0);
+		for (uint i = 0u; i < uNGravity; i++) {
+			if (gPoint[i].active == 0u) continue;
+			vec3 dir = gPoint[i].position.xyz - pos;
+			float dist = length(dir);
+			if (dist < 0.2) continue;
+
+			float angle = hash(rid ^ (i * 2654435761u)) * 2.0 * PI;
+			vec3 randAxis = normalize(vec3(cos(angle), sin(angle * 0.7 + 1.0), sin(angle)));
+			orbitalVel += normalize(cross(dir / dist, randAxis)) * sqrt(gPoint[i].mass / dist);
+		}
+		return vec4((normalVel * 0.7 + orbitalVel * 0.3) * 0.8, velocity.w);
+	}
+	if (uSpeed == 3u) {
+		vec3 totalVel = vec3(0.0);
+		for (uint i = 0u; i < uNGravity; i++) {
+			if (gPoint[i].active == 0u) continue;
+			vec3 dir = gPoint[i].position.xyz - pos;
+			float dist = length(dir);
+			if (dist < 0.2) continue;
+
+			// Axe aléatoire pour la tangente, excentricité légère (±15%)
+			float angle1 = hash(rid * 2u ^ i) * 2.0 * PI;
+			float angle2 = hash(rid * 3u ^ i) * PI;
+			vec3 axis = normalize(vec3(sin(angle2) * cos(angle1), cos(angle2), sin(angle2) * sin(angle1)));
+			float eccFactor = 0.85 + hash(rid * 5u ^ i) * 0.3;
+			totalVel += normalize(cross(dir / dist, axis)) * sqrt(gPoint[i].mass / dist) * eccFactor;
+		}
+		return vec4(totalVel, velocity.w);
+	}
+	if (uSpeed == 4u)
+		return vec4(3.0, 0.0, 0.0, 0.0);
+	return velocity;
+}
+
+void main() {
+	uint gid = uFirst + gl_GlobalInvocationID.x;
+	if (gid >= uNbParticles) return;
+
+	// Random stream of this particle: seed 0 gives back the historical layout
+	uint rid = gid + uSeed * 2654435761u;
+
+	vec4 pos = positions[gid];
+	if (uShape == 0) pos = createSphere(uRadius, gid, uNbParticles);
+	else if (uShape == 1) pos = createCube(uRadius, rid);
+	else if (uShape == 2) pos = createPyramid(gid, uNbParticles, uRadius);
+
+	positions[gid] = pos;
+	velocities[gid] = initSpeed(pos.xyz, velocities[gid], rid);
+}
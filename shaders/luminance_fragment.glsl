@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 vUv;
+
+uniform sampler2D uHdr;
+
+out vec2 outLum;
+
+// Log luminance and coverage: the mipmap averages both, their ratio is the
+// log-average over the covered pixels only, the background doesn't count
+void main() {
+	float l = dot(texture(uHdr, vUv).rgb, vec3(0.2126, 0.7152, 0.0722));
+	outLum = l > 1e-4 ? vec2(log(l), 1.0) : vec2(0.0);
+}
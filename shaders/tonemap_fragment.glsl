@@ -0,0 +1,33 @@
+#version 330 core
+in vec2 vUv;
+
+uniform sampler2D uHdr;
+uniform sampler2D uAdapt;
+
+// Per-frame data, same block as vertex.glsl
+layout (std140) uniform Frame {
+	mat4 uView;
+	mat4 uProjection;
+	mat4 uViewProj;
+	vec4 uViewport;
+	float uTime;
+	float uExposure;	// key: mid-grey the average luminance maps to
+	float uPointSize;
+	float uAlpha;
+	int uSoft;
+	float uInterp;
+};
+
+out vec4 outColor;
+
+// ACES filmic fit (Narkowicz)
+vec3 aces(vec3 x) {
+	return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main() {
+	vec3 hdr = texture(uHdr, vUv).rgb;
+	float average = texture(uAdapt, vec2(0.5)).r;
+	vec3 mapped = aces(hdr * uExposure / max(average, 1e-4));
+	outColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+
+// No attribute: one instance per trail, vertex 0 is the oldest slot of its ring
+uniform samplerBuffer uTrail;	// length positions per trail, written by recordTrails
+uniform samplerBuffer uColors;	// particle colors
+uniform int uLength;
+uniform int uHead;				// slot written last
+uniform int uStride;			// trail i follows particle i * uStride
+uniform float uTrailAlpha;
+
+// Per-frame data, same block as vertex.glsl
+layout (std140) uniform Frame {
+	mat4 uView;
+	mat4 uProjection;
+	mat4 uViewProj;
+	vec4 uViewport;
+	float uTime;
+	float uExposure;
+	float uPointSize;
+	float uAlpha;
+	int uSoft;
+	float uInterp;
+};
+
+out vec4 vColor;
+
+void main()
+{
+	int slot = (uHead + 1 + gl_VertexID) % uLength;
+	vec4 pos = texelFetch(uTrail, gl_InstanceID * uLength + slot);
+	float age = float(gl_VertexID) / float(uLength - 1);	// 0 oldest, 1 newest
+
+	gl_Position = uViewProj * pos;
+	vColor = vec4(texelFetch(uColors, gl_InstanceID * uStride).rgb, uTrailAlpha * age * age);
+}
@@ -0,0 +1,120 @@
+#version 430 core
+
+// updateSpace of kernels.cl, GL compute backend: the buffers are the vertex
+// buffers themselves, nothing to acquire or release
+layout (local_size_x = 128) in;
+
+#define SOFTENING       0.2
+#define MAX_SPEED       15.0
+#define CAPTURE_RADIUS  0.5
+
+struct GravityPoint {
+	float mass;
+	vec4 position;
+	uint active;
+	int type;
+};
+
+layout (std430, binding = 0) buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) buffer Velocities { vec4 velocities[]; };
+layout (std430, binding = 2) buffer Colors { vec4 colors[]; };
+layout (std430, binding = 3) readonly buffer Gravity { GravityPoint gPoint[]; };
+
+uniform uint uNbParticles;
+uniform float uDt;
+uniform float uTime;
+uniform uint uNGravity;
+uniform uint uColorMode;
+uniform float uSpeedScale;
+
+vec3 curlNoise(vec3 p, float t) {
+	float eps = 0.01;
+	return vec3(
+		(sin((p.y + eps) * 1.3 + t) * cos(p.z * 0.9) - sin(p.y * 1.3 + t) * cos((p.z + eps) * 0.9)) / eps,
+		(sin(p.z * 1.1 + t) * cos((p.x + eps) * 1.2) - sin((p.z + eps) * 1.1 + t) * cos(p.x * 1.2)) / eps,
+		(sin((p.x + eps) * 0.8 + t) * cos(p.y * 1.4) - sin(p.x * 0.8 + t) * cos((p.y + eps) * 1.4)) / eps
+	);
+}
+
+vec3 speedColor(vec3 vel, vec3 pos) {
+	if (uColorMode == 0u) {
+		float speedNorm = clamp(length(vel) / uSpeedScale, 0.0, 1.0);
+		speedNorm = speedNorm * speedNorm;  // Courbe quadratique
+		vec3 coldColor = vec3(0.3, 0.0, 0.8);
+		vec3 midColor  = vec3(1.0, 0.2, 0.6);
+		vec3 hotColor  = vec3(1.0, 0.8, 0.0);
+		return speedNorm < 0.5 ? mix(coldColor, midColor, speedNorm * 2.0)
+			: mix(midColor, hotColor, (speedNorm - 0.5) * 2.0);
+	}
+	if (uColorMode == 1u) {
+		float speedNorm = clamp(length(vel) / (uSpeedScale * 8.0 / 7.0), 0.0, 1.0);
+		speedNorm = 1.0 - exp(-speedNorm * 3.0);  // Courbe exponentielle inversée
+		if (speedNorm < 0.3)
+			return mix(vec3(0.0, 0.0, 0.3), vec3(0.2, 0.4, 1.0), speedNorm / 0.3);
+		if (speedNorm < 0.6)
+			return mix(vec3(0.2, 0.4, 1.0), vec3(1.0, 1.0, 0.8), (speedNorm - 0.3) / 0.3);
+		return mix(vec3(1.0, 1.0, 0.8), vec3(1.0, 0.1, 0.0), (speedNorm - 0.6) / 0.4);
+	}
+	// Distance to the closest source, by bands of 20
+	float dist = 2147483647.0;
+	vec3 color = vec3(0.0);
+	for (uint i = 0u; i < uNGravity; i++) {
+		dist = min(dist, length(gPoint[i].position.xyz - pos));
+		int sw = int(dist / 20.0);
+		if (sw < 6)
+			color = mix(vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0), float(sw) / 5.0);
+		else
+			color = vec3(abs(sin(uTime)), abs(cos(uTime) * sin(uTime)), abs(cos(uTime)));
+	}
+	return color;
+}
+
+void main() {
+	uint gid = gl_GlobalInvocationID.x;
+	if (gid >= uNbParticles) return;
+
+	vec3 pos = positions[gid].xyz;
+	vec3 vel = velocities[gid].xyz;
+	vec3 totalForce = vec3(0.0);
+
+	for (uint i = 0u; i < uNGravity; i++) {
+		if (gPoint[i].active == 0u) continue;
+
+		vec3 dir = gPoint[i].position.xyz - pos;
+		float dist = length(dir);
+		vec3 dirNorm = dir / dist;
+		int type = gPoint[i].type;
+
+		if (type != 2 && dist < CAPTURE_RADIUS) {
+			vel *= 0.80;
+			continue;
+		}
+		if (type == 0) {
+			// Gravité classique
+			float invDist = inversesqrt(dot(dir, dir) + 0.01);
+			totalForce += gPoint[i].mass * dir * invDist * invDist * invDist;
+		} else if (type == 1) {
+			// Lorentz : champ magnétique centré sur le point
+			vec3 B = dirNorm * gPoint[i].mass / (dist * dist + SOFTENING);
+			totalForce += cross(vel, B);
+		} else if (type == 2) {
+			// Turbulence / Curl noise centré sur le point
+			vec3 curl = curlNoise((pos - gPoint[i].position.xyz) * 0.5, uTime);
+			totalForce += curl * gPoint[i].mass / (dist + 1.0);
+		} else if (type == 3) {
+			// Répulsion pure
+			float invDist = inversesqrt(dist * dist + SOFTENING * SOFTENING);
+			totalForce -= gPoint[i].mass * dirNorm * dist * invDist * invDist * invDist;
+		}
+	}
+
+	vel += totalForce * uDt;
+	float speed = length(vel);
+	if (speed > MAX_SPEED) vel *= MAX_SPEED / speed;
+	pos += vel * uDt;
+
+	if (uColorMode != 3u)		// loaded colors: written once by the shape or the point cloud
+		colors[gid].xyz = speedColor(vel, pos);
+	positions[gid].xyz = pos;
+	velocities[gid].xyz = vel;
+}
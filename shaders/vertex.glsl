@@ -2,14 +2,31 @@
 
 layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec4 aColor;
+layout (location = 2) in vec4 aPrevPos;	// before the last simulation step
 
-uniform mat4 uMVP;
+// Per-frame data, written once by FrameUniforms
+layout (std140) uniform Frame {
+	mat4 uView;
+	mat4 uProjection;
+	mat4 uViewProj;
+	vec4 uViewport;
+	float uTime;
+	float uExposure;
+	float uPointSize;	// grows with the level of detail
+	float uAlpha;		// and fades what it can't compensate
+	int uSoft;
+	float uInterp;		// fixed step: display time inside the last step, 1 otherwise
+};
+
+uniform mat4 uModel;	// axis gizmo, identity for the particles
 
 out vec4 vColor;
 
 void main()
 {
-    gl_Position = uMVP * aPos;
-    vColor = aColor;
-	gl_PointSize = 2.0;
+	// The previous positions are not kept without fixed step, never read them then
+	vec4 pos = uInterp < 1.0 ? mix(aPrevPos, aPos, uInterp) : aPos;
+    gl_Position = uViewProj * uModel * pos;
+    vColor = vec4(aColor.rgb, uAlpha);
+	gl_PointSize = uPointSize;
 }
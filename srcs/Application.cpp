@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/12/17 13:42:47 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/18 16:30:22 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 01:09:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -38,19 +38,24 @@ void Application::init(int argc, char **argv) {
 	
 	initGLFW();
 	initOpenGL();
-	_system = std::make_unique<ParticleSystem>(_nbParticle, _shape);
+	_system = std::make_unique<ParticleSystem>(_nbParticle, _shape, _deviceName, _split, _backend);
 	_system->setupRendering();
+	if (!_snapshotPath.empty())
+		_system->loadSnapshot(_snapshotPath);	// Restart a previous run
+	if (!_cloudPath.empty())
+		_system->loadPointCloud(_cloudPath, _cloudStride, _cloudFit);	// Scan or external simulation
 
 	initShader();
 	_imguiLayer.initImGui(_window);
 }
 
 void Application::checkinput(int argc, char **argv) {
-	if (argc != 3){
+	if (argc < 3 || (argc - 3) % 2 != 0){
 		ostringstream oss;
 		oss << "   The program needs 2 arguments: " << std::endl;
 		oss << "      \033[33m_the number of particle" << std::endl;
-		oss << "      _the shape (sphere or cube)" << std::endl;
+		oss << "      _the shape (sphere, cube, a .obj mesh or an image)" << std::endl;
+		oss << "      _options: --load <file.psnap>, --cloud <file.ply|raw> [--stride <3|4|6|9>] [--fit <radius>], --device <name|list>, --split <numa|name,name>, --backend <cl|gl>" << std::endl;
 		oss << "	  Everything can be change while playing!\033[0m" << std::endl;
 		throw inputError(oss.str());
 	}
@@ -66,8 +71,45 @@ void Application::checkinput(int argc, char **argv) {
 		throw inputError("\033[33m   Warning, the number must be positiv strict !\033[0m");		
 
 	_shape = std::string(argv[2]);
-	if (_shape != "sphere" && _shape != "cube")
-		throw inputError("\033[33m   Warning, the shpe must be 'sphere' or 'cube' !\033[0m");
+	if (_shape != "sphere" && _shape != "cube" && !isObjPath(_shape) && !isPicturePath(_shape))
+		throw inputError("\033[33m   Warning, the shpe must be 'sphere', 'cube', a .obj file or an image !\033[0m");
+
+	// Optional "--name value" pairs
+	for (int i = 3; i < argc; i += 2) {
+		std::string opt(argv[i]);
+		if (opt == "--load")
+			_snapshotPath = argv[i + 1];
+		else if (opt == "--cloud")
+			_cloudPath = argv[i + 1];
+		else if (opt == "--stride" || opt == "--fit") {
+			try {
+				if (opt == "--stride")
+					_cloudStride = std::stoi(argv[i + 1]);
+				else
+					_cloudFit = std::stof(argv[i + 1]);
+			} catch (const std::exception&) {
+				throw inputError("\033[33m   " + opt + " needs a number\033[0m");
+			}
+		}
+		else if (opt == "--device" && std::string(argv[i + 1]) == "list") {
+			ostringstream oss;
+			for (const ClDeviceInfo &dev : listClDevices())
+				oss << "      " << dev.label() << (dev.glSharing ? "" : "  (no GL sharing)") << std::endl;
+			oss << "   Pick one with --device <part of its name>" << std::endl;
+			throw inputError(oss.str());
+		}
+		else if (opt == "--device")
+			_deviceName = argv[i + 1];
+		else if (opt == "--split")
+			_split = argv[i + 1];
+		else if (opt == "--backend") {
+			_backend = argv[i + 1];
+			if (_backend != "cl" && _backend != "gl")
+				throw inputError("\033[33m   The backend must be 'cl' (OpenCL) or 'gl' (compute shaders) !\033[0m");
+		}
+		else
+			throw inputError("\033[33m   Unknown option " + opt + "\033[0m");
+	}
 }
 
 void Application::initGLFW() {
@@ -132,6 +174,7 @@ void Application::initOpenGL() {
 	// Charger les fonctions OpenGL avec Glad
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		throw openGlError("   \033[33mFailed to initialize GLAD\033[0m");
+	loadGlExtensions((GLADloadproc)glfwGetProcAddress);
 	
 	// Configuration OpenGL
 	glViewport(0, 0, WIDTH, HEIGHT);
@@ -181,10 +224,21 @@ void Application::initShader() {
 
 	glDeleteShader(vShader);
 	glDeleteShader(fShader);
+
+	// Camera and per-frame values come from the Frame block, only the model is a uniform
+	bindFrameBlock(_shaderProgram);
+	_modelLoc = glGetUniformLocation(_shaderProgram, "uModel");
 }
 
 void Application::cleanup() {
+	_exporter.stop();			// needs the GL context
+	_recorder.stop();
+	_player.close();
+	_system.reset();			// GL buffers and the CL context shared with it
 	_axisGizmo.cleanup();
+	_hdr.cleanup();
+	_trails.cleanup();
+	_frame.cleanup();
 	if (_shaderProgram) glDeleteProgram(_shaderProgram);
 	glfwDestroyWindow(_window);
 	glfwTerminate();
@@ -194,43 +248,118 @@ void Application::run() {
 	_lastFrameTime = glfwGetTime();
 	_lastFpsTime = _lastFrameTime;
 	_axisGizmo.init(_shaderProgram);
+	_hdr.init();
+	_frame.init();
+	_trails.init();
 	
 	while (!glfwWindowShouldClose(_window)) {
 		float currentTime = glfwGetTime();
 		// dt OpenCl
-		float dt = currentTime - _lastFrameTime;
-		dt = std::min(dt, 0.02f);
+		float frameTime = currentTime - _lastFrameTime;
+		float dt = std::min(frameTime, 0.02f);
 		_lastFrameTime = currentTime;
+
+		// Offline export: fixed dt and no vsync, the loop runs at simulation speed
+		syncExport();
+		if (_exporting)
+			dt = _exporter.frameDt();
 		
 		// Fps
 		handleFps();
 		
 		handleKey();
+
+		if (!_deviceRequest.empty()) {
+			switchDevice(_deviceRequest);
+			_deviceRequest.clear();
+		}
 		
+		_system->beginFrame();
+
 		// 1. OpenCL écrit → OpenGL lit
-		_system->update(dt);
+		// A recording being played replaces the simulation
+		float interp = 1.0f;
+		if (_player.isOpen()) {
+			_player.update(dt, *_system);
+		} else if (_system->isStreaming()) {
+			_system->streamStep(dt);
+		} else {
+			// Fixed step: whole steps only, the display interpolates inside the last one
+			const int rate = _exporting ? 0 : _system->stepRate();
+			float stepDt = dt;
+			int steps = 1;
+			if (rate > 0) {
+				stepDt = 1.0f / rate;
+				_stepAccumulator = std::min(_stepAccumulator + frameTime, SIM_MAX_STEPS * stepDt);
+				steps = static_cast<int>(_stepAccumulator / stepDt);
+				_stepAccumulator -= steps * stepDt;
+			}
+			for (int i = 0; i < steps; ++i) {
+				if (rate > 0 && i + 1 == steps)
+					_system->keepPrevious();
+				_system->update(stepDt);
+				_recorder.onStep(*_system);
+			}
+			if (rate > 0)
+				interp = _system->interpolation(_stepAccumulator / stepDt);
+		}
 		
 		// 2. OpenGL rend
 		updateCam();
 
+		if (_exporting)
+			_exporter.beginFrame();
+
 		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 mvp = getProjectionMatrix() * getViewMatrix() * model;
 		glUseProgram(_shaderProgram);
-		
-		GLuint uMVP = glGetUniformLocation(_shaderProgram, "uMVP");
-		glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(mvp));
+		glUniformMatrix4fv(_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 		
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		
-		_system->render();
+		// Offline export: frame time means nothing, only the output size
+		int width  = _exporting ? _exporter.getWidth()  : _currentWidth;
+		int height = _exporting ? _exporter.getHeight() : _currentHeight;
+		_system->updateLod(mvp, width, height, _exporting ? 0.0f : frameTime);
+		_system->cull(mvp);		// no-op without GL sharing, or when disabled
+
+		// Everything the shaders need this frame, one upload
+		const bool hdr = _hdr.enabled();
+		FrameData frame = {};
+		frame.view       = getViewMatrix();
+		frame.projection = getProjectionMatrix();
+		frame.viewProj   = frame.projection * frame.view;
+		frame.viewport   = glm::vec4(width, height, 1.0f / width, 1.0f / height);
+		frame.time       = _system->getTime();
+		frame.exposure   = _hdr.key();
+		frame.pointSize  = _system->getPointSize();
+		frame.alpha      = _system->getPointAlpha() * (hdr ? _hdr.gain() : 1.0f);
+		frame.soft       = _system->softSprites() ? 1 : 0;
+		frame.interp     = interp;
+		_frame.upload(frame);
+
+		// HDR: summed into the offscreen target, then tonemapped over the frame
+		if (hdr) {
+			_hdr.begin(width, height);
+			glUseProgram(_shaderProgram);
+		}
+		_system->render(hdr);
+		_trails.render(*_system, hdr, hdr ? _hdr.gain() : 1.0f);
+		if (hdr)
+			_hdr.resolve(_exporting ? _exporter.frameDt() : frameTime);
 		glFlush();
 		
-		_axisGizmo.render(getViewMatrix(), getProjectionMatrix(), 0.1f, glm::vec3(0.0f, 0.0f, 0.0f));
+		_axisGizmo.render(0.1f, glm::vec3(0.0f, 0.0f, 0.0f));
+		_frame.endFrame();
+
+		// Readback queued in the PBO ring, the window shows a preview
+		if (_exporting)
+			_exporter.endFrame(_currentWidth, _currentHeight);
 		
 		if (hPressed) {	
 			_imguiLayer.beginFrame();
-			_imguiLayer.render(*_system, _cameraMode, _cameraOrbit);
+			_imguiLayer.render(*_system, _cameraMode, _cameraOrbit, _recorder, _player, _exporter, _hdr, _deviceRequest);
 			_imguiLayer.endFrame();
 		}
 
@@ -238,9 +367,51 @@ void Application::run() {
 		glfwPollEvents();
 
 	}
+	_exporter.stop();
 	_imguiLayer.shutdown();
 }
 
+// Applies the start or the end of an export: vsync and the camera aspect ratio
+void Application::syncExport() {
+	bool active = _exporter.isActive();
+	if (active == _exporting)
+		return;
+	_exporting = active;
+
+	int width  = active ? _exporter.getWidth()  : _currentWidth;
+	int height = active ? _exporter.getHeight() : _currentHeight;
+	glfwSwapInterval(active ? 0 : 1);
+	_cameraFps.updateProjectionMatrix(width, height);
+	_cameraOrbit.updateProjectionMatrix(width, height);
+}
+
+// New CL context on another device. The particles go through a snapshot,
+// the simulation carries on where it was.
+void Application::switchDevice(const std::string &name) {
+	const std::string tmp = (std::filesystem::temp_directory_path() / "particle_system_switch.psnap").string();
+	const std::string previous = _system->isGlCompute() ? "" : _system->getDevice().label();
+	const std::string previousBackend = _system->isGlCompute() ? "gl" : "cl";
+	const bool compute = name == GL_COMPUTE_LABEL;
+
+	_recorder.stop();
+	_player.close();
+	_system->saveSnapshot(tmp);
+	_system.reset();			// one context at a time
+
+	try {
+		_system = std::make_unique<ParticleSystem>(_nbParticle, _shape, compute ? "" : name, "", compute ? "gl" : "cl");
+		_deviceName = compute ? "" : name;
+		_backend = compute ? "gl" : "cl";
+		_split.clear();			// the UI picks a single device
+	} catch (std::exception &e) {
+		std::cerr << "Can't switch to " << name << ":" << std::endl << e.what() << std::endl;
+		_system = std::make_unique<ParticleSystem>(_nbParticle, _shape, previous, "", previousBackend);
+	}
+	_system->setupRendering();
+	_system->loadSnapshot(tmp);
+	std::filesystem::remove(tmp);
+}
+
 void Application::handleFps() {
 	_fps++;
 	float currentTime = glfwGetTime();
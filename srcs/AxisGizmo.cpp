@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/26 12:15:33 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/01/26 12:27:07 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 20:39:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -14,7 +14,7 @@
 #include <iostream>
 
 
-AxisGizmo::AxisGizmo() : _vao(0), _vbo(0), _ebo(0), _indexCount(0), _shaderProgram(0) {}
+AxisGizmo::AxisGizmo() : _vao(0), _vbo(0), _ebo(0), _indexCount(0), _shaderProgram(0), _modelLoc(-1) {}
 
 AxisGizmo::~AxisGizmo() {
 	cleanup();
@@ -22,6 +22,7 @@ AxisGizmo::~AxisGizmo() {
 
 void AxisGizmo::init(GLuint shaderProgram) {
 	_shaderProgram = shaderProgram;
+	_modelLoc = glGetUniformLocation(_shaderProgram, "uModel");
 	
 	// Vertices: Position (3) + Color (3)
 	float vertices[] = {
@@ -66,13 +67,16 @@ void AxisGizmo::init(GLuint shaderProgram) {
 	// Color attribute (location 1)
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+
+	// Previous position (location 2): the axes don't move, same as the position
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(2);
 	
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 }
 
-void AxisGizmo::render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
-					float scale, glm::vec3 position) {
+void AxisGizmo::render(float scale, glm::vec3 position) {
 	glUseProgram(_shaderProgram);
 	
 	// Utiliser la caméra du monde réel
@@ -80,12 +84,8 @@ void AxisGizmo::render(const glm::mat4& viewMatrix, const glm::mat4& projectionM
 	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
 	model = glm::scale(model, glm::vec3(scale));
 	
-	// Calculer MVP avec la vraie caméra du monde
-	glm::mat4 mvp = projectionMatrix * viewMatrix * model;
-	
-	// Passer MVP au shader
-	GLint mvpLoc = glGetUniformLocation(_shaderProgram, "uMVP");
-	glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
+	// La caméra vient du bloc Frame, seul le modèle est propre au gizmo
+	glUniformMatrix4fv(_modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 	
 	// Désactiver le test de profondeur pour que les axes soient toujours visibles
 	glDisable(GL_DEPTH_TEST);
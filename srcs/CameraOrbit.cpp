@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/12 14:10:42 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/01/16 15:37:22 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 12:04:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -68,7 +68,18 @@ void CameraOrbit::updateView() {
 
 void CameraOrbit::processScroll(float yoffset) {
 	_distance -= yoffset * 0.5f;
-	_distance = glm::clamp(_distance, 1.0f, 50.0f);
+	// A framed cloud may sit further than 50, scrolling only brings it closer
+	_distance = glm::clamp(_distance, 1.0f, std::max(50.0f, _distance + yoffset * 0.5f));
+	updateView();
+}
+
+// Fits a sphere in the field of view, blend < 1 moves part of the way (smooth follow)
+void CameraOrbit::frame(const glm::vec3 &center, float radius, float blend) {
+	float distance = radius / std::sin(glm::radians(_fov * 0.5f));
+	distance = glm::clamp(distance, 1.0f, 2500.0f);
+
+	_target   = glm::mix(_target, center, blend);
+	_distance = glm::mix(_distance, distance, blend);
 	updateView();
 }
 
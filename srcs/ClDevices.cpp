@@ -0,0 +1,131 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ClDevices.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 12:24:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 14:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ClDevices.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+static std::string platformString(cl_platform_id platform, cl_platform_info param) {
+	size_t size = 0;
+	clGetPlatformInfo(platform, param, 0, nullptr, &size);
+	std::string str(size, '\0');
+	clGetPlatformInfo(platform, param, size, &str[0], nullptr);
+	str.resize(str.find('\0') == std::string::npos ? str.size() : str.find('\0'));
+	return str;
+}
+
+static std::string deviceString(cl_device_id device, cl_device_info param) {
+	size_t size = 0;
+	clGetDeviceInfo(device, param, 0, nullptr, &size);
+	std::string str(size, '\0');
+	clGetDeviceInfo(device, param, size, &str[0], nullptr);
+	str.resize(str.find('\0') == std::string::npos ? str.size() : str.find('\0'));
+	return str;
+}
+
+static std::string lower(std::string str) {
+	std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+	return str;
+}
+
+std::vector<ClDeviceInfo> listClDevices() {
+	std::vector<ClDeviceInfo> devices;
+
+	cl_uint nPlatforms = 0;
+	if (clGetPlatformIDs(0, nullptr, &nPlatforms) != CL_SUCCESS || nPlatforms == 0)
+		return devices;
+	std::vector<cl_platform_id> platforms(nPlatforms);
+	clGetPlatformIDs(nPlatforms, platforms.data(), nullptr);
+
+	for (cl_platform_id platform : platforms) {
+		cl_uint nDevices = 0;
+		if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &nDevices) != CL_SUCCESS || nDevices == 0)
+			continue;
+		std::vector<cl_device_id> ids(nDevices);
+		clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, nDevices, ids.data(), nullptr);
+
+		std::string platformName = platformString(platform, CL_PLATFORM_NAME);
+		for (cl_device_id id : ids) {
+			ClDeviceInfo info;
+			info.platform     = platform;
+			info.device       = id;
+			info.platformName = platformName;
+			info.name         = deviceString(id, CL_DEVICE_NAME);
+			clGetDeviceInfo(id, CL_DEVICE_TYPE, sizeof(info.type), &info.type, nullptr);
+			clGetDeviceInfo(id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(info.computeUnits), &info.computeUnits, nullptr);
+			clGetDeviceInfo(id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(info.globalMem), &info.globalMem, nullptr);
+			std::string ext = deviceString(id, CL_DEVICE_EXTENSIONS);
+			info.glSharing = ext.find("cl_khr_gl_sharing") != std::string::npos
+				|| ext.find("cl_APPLE_gl_sharing") != std::string::npos;
+			devices.push_back(info);
+		}
+	}
+	return devices;
+}
+
+const ClDeviceInfo& selectClDevice(const std::vector<ClDeviceInfo>& devices, const std::string &name) {
+	if (devices.empty())
+		throw openClError("   \033[33mNo OpenCL device found\033[0m");
+
+	if (!name.empty()) {
+		std::string wanted = lower(name);
+		for (const ClDeviceInfo &info : devices) {
+			if (lower(info.label()).find(wanted) != std::string::npos)
+				return info;
+		}
+		std::ostringstream oss;
+		oss << "   \033[33mNo OpenCL device matches '" << name << "', available:\033[0m";
+		for (const ClDeviceInfo &info : devices)
+			oss << std::endl << "      " << info.label();
+		throw openClError(oss.str());
+	}
+
+	for (const ClDeviceInfo &info : devices)
+		if ((info.type & CL_DEVICE_TYPE_GPU) && info.glSharing) return info;
+	for (const ClDeviceInfo &info : devices)
+		if (info.type & CL_DEVICE_TYPE_GPU) return info;
+	return devices.front();
+}
+
+std::vector<cl_device_id> createNumaSubDevices(cl_device_id device) {
+	cl_device_partition_property props[] = {
+		CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0
+	};
+	// First call only counts, nothing is created for a single NUMA node
+	cl_uint count = 0;
+	if (clCreateSubDevices(device, props, 0, nullptr, &count) != CL_SUCCESS || count < 2)
+		return {};
+	std::vector<cl_device_id> subDevices(count);
+	if (clCreateSubDevices(device, props, count, subDevices.data(), nullptr) != CL_SUCCESS)
+		return {};
+	return subDevices;
+}
+
+std::vector<ClDeviceInfo> selectClDevices(const std::vector<ClDeviceInfo>& devices, const std::string &names) {
+	std::vector<ClDeviceInfo> selected;
+	std::istringstream iss(names);
+	std::string name;
+	while (std::getline(iss, name, ',')) {
+		const ClDeviceInfo &info = selectClDevice(devices, name);
+		if (!selected.empty() && info.platform != selected.front().platform)
+			throw openClError("   \033[33m" + info.label() + " and " + selected.front().label()
+				+ " are on different platforms, they can't share a context\033[0m");
+		bool twice = false;
+		for (const ClDeviceInfo &other : selected)
+			twice |= other.device == info.device;
+		if (!twice)
+			selected.push_back(info);
+	}
+	return selected;
+}
@@ -0,0 +1,125 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DeviceArena.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 16:19:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 16:49:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#include "DeviceArena.hpp"
+
+#include <algorithm>
+
+// Constructeur
+DeviceArena::DeviceArena()
+	: _pool(nullptr), _queue(nullptr), _align(128), _capacity(0),
+	  _persistentEnd(0), _scratchUsed(0), _scratchTop(0), _scratchPeak(0) {}
+
+void DeviceArena::init(ResourcePool &pool, cl_command_queue queue, const std::vector<cl_device_id> &devices, size_t bytes) {
+	release();
+	_pool = &pool;
+	_queue = queue;
+
+	// CL_DEVICE_MEM_BASE_ADDR_ALIGN is in bits, sub-buffer origins must follow it
+	_align = 128;
+	for (cl_device_id device : devices) {
+		cl_uint bits = 0;
+		clGetDeviceInfo(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(bits), &bits, nullptr);
+		_align = std::max(_align, static_cast<size_t>(bits / 8));
+	}
+	_capacity = alignUp(bytes);
+	_buffer = _pool->buffer(CL_MEM_READ_WRITE, _capacity);
+}
+
+void DeviceArena::release() {
+	_overflow.clear();
+	_scratch.clear();
+	_regions.clear();		// sub-buffers before their parent
+	_buffer.reset();
+	_capacity = _persistentEnd = 0;
+	_scratchUsed = _scratchTop = _scratchPeak = 0;
+}
+
+void DeviceArena::carve(Region &region) {
+	cl_buffer_region r = {region.offset, region.size};
+	cl_int err;
+	region.mem.reset(clCreateSubBuffer(_buffer, region.flags, CL_BUFFER_CREATE_TYPE_REGION, &r, &err));
+	if (err != CL_SUCCESS)
+		throw openClError("Failed to carve " + std::to_string(region.size) + " bytes out of the arena");
+}
+
+int DeviceArena::persistent(size_t size, cl_mem_flags flags) {
+	Region region;
+	region.offset = alignUp(_persistentEnd);
+	region.size = size;
+	region.flags = flags;
+
+	// Persistent regions push the scratch back: the frame starts over from there
+	if (region.offset + size + _scratchPeak > _capacity)
+		grow(region.offset + size + _scratchPeak);
+	_scratch.clear();
+	_scratchUsed = 0;
+
+	carve(region);
+	_persistentEnd = region.offset + size;
+	_scratchTop = _persistentEnd;
+	_regions.push_back(std::move(region));
+	return static_cast<int>(_regions.size() - 1);
+}
+
+cl_mem DeviceArena::scratch(size_t size, cl_mem_flags flags) {
+	size_t offset = alignUp(_scratchTop);
+	_scratchTop = offset + size;
+	_scratchPeak = std::max(_scratchPeak, _scratchTop - _persistentEnd);
+
+	// Full: a buffer of its own for this frame, the arena grows at the next one
+	if (_scratchTop > _capacity) {
+		_overflow.push_back(_pool->buffer(flags, size));
+		return _overflow.back();
+	}
+
+	// The same requests come back every frame, so do the sub-buffers
+	if (_scratchUsed == _scratch.size())
+		_scratch.emplace_back();
+	Region &slot = _scratch[_scratchUsed++];
+	if (!slot.mem || slot.offset != offset || slot.size != size || slot.flags != flags) {
+		slot.offset = offset;
+		slot.size = size;
+		slot.flags = flags;
+		carve(slot);
+	}
+	return slot.mem;
+}
+
+void DeviceArena::beginFrame() {
+	for (ClMem &mem : _overflow)
+		_pool->recycle(mem);
+	_overflow.clear();
+
+	if (_persistentEnd + _scratchPeak > _capacity)
+		grow(_persistentEnd + _scratchPeak);
+	_scratchUsed = 0;
+	_scratchTop = _persistentEnd;
+	_scratchPeak = 0;
+}
+
+// New buffer, persistent regions copied at the same offsets, scratch recarved on demand
+void DeviceArena::grow(size_t bytes) {
+	size_t capacity = alignUp(std::max(bytes, _capacity + _capacity / 2));
+	ClMem buffer = _pool->buffer(CL_MEM_READ_WRITE, capacity);
+	if (_persistentEnd)
+		clEnqueueCopyBuffer(_queue, _buffer, buffer, 0, 0, _persistentEnd, 0, nullptr, nullptr);
+
+	_scratch.clear();
+	for (Region &region : _regions)
+		region.mem.reset();
+	_buffer = std::move(buffer);		// the driver keeps the old one until the copy is done
+	_capacity = capacity;
+	for (Region &region : _regions)
+		carve(region);
+}
@@ -0,0 +1,298 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FrameExporter.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 11:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:44:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "FrameExporter.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STBI_WRITE_NO_STDIO			// files opened here, write errors checked
+#include "stb_image_write.h"
+
+#include <cstring>
+
+// Constructeur
+FrameExporter::FrameExporter(): _format(ExportFormat::PNG), _width(0), _height(0), _fps(60),
+	_maxFrames(0), _fbo(0), _colorRbo(0), _depthRbo(0), _pbo{0, 0, 0}, _fence{nullptr, nullptr, nullptr},
+	_slotFrame{0, 0, 0}, _head(0), _inFlight(0), _captured(0), _stopping(false), _video(nullptr) {}
+
+FrameExporter::~FrameExporter() {
+	stop();
+}
+
+void FrameExporter::start(const std::string &output, int width, int height, ExportFormat format, int fps, int maxFrames) {
+	stop();
+	if (width <= 0 || height <= 0 || fps <= 0)
+		throw openGlError("   \033[33mInvalid export resolution or frame rate\033[0m");
+
+	_output    = output;
+	_format    = format;
+	_width     = width;
+	_height    = height;
+	_fps       = fps;
+	_maxFrames = maxFrames;
+	_head      = 0;
+	_inFlight  = 0;
+	_captured  = 0;
+	_stopping  = false;
+	_error.clear();
+	stbi_flip_vertically_on_write(1);
+
+	if (_format == ExportFormat::Y4M) {
+		_video = std::fopen(_output.c_str(), "wb");
+		if (!_video)
+			throw fileError("   \033[33mCannot create " + _output + "\033[0m");
+		std::fprintf(_video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", _width, _height, _fps);
+	}
+
+	// Offscreen target, independent of the window size
+	glGenFramebuffers(1, &_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+
+	glGenRenderbuffers(1, &_colorRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, _colorRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRbo);
+
+	glGenRenderbuffers(1, &_depthRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, _depthRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _width, _height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRbo);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		stop();
+		throw openGlError("   \033[33mExport framebuffer is incomplete\033[0m");
+	}
+
+	// GL_STREAM_READ: the driver keeps these in memory the CPU reads fast
+	const GLsizeiptr frameSize = static_cast<GLsizeiptr>(_width) * _height * 4;
+	glGenBuffers(RING, _pbo);
+	for (int i = 0; i < RING; ++i) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ);
+		_fence[i] = nullptr;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	_worker = std::thread(&FrameExporter::workerLoop, this);
+}
+
+void FrameExporter::stop() {
+	if (!_fbo)
+		return;
+
+	// Drain the ring, oldest first
+	while (_inFlight > 0)
+		collect((_head - _inFlight + RING) % RING, true);
+
+	if (_worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_cv.notify_all();
+		_worker.join();
+	}
+	if (_video) {
+		if (std::fclose(_video) != 0)
+			fail("Failed to write " + _output);
+		_video = nullptr;
+	}
+
+	glDeleteBuffers(RING, _pbo);
+	glDeleteRenderbuffers(1, &_colorRbo);
+	glDeleteRenderbuffers(1, &_depthRbo);
+	glDeleteFramebuffers(1, &_fbo);
+	for (int i = 0; i < RING; ++i) _pbo[i] = 0;
+	_colorRbo = _depthRbo = _fbo = 0;
+	_queue.clear();
+	_free.clear();
+}
+
+void FrameExporter::beginFrame() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+	glViewport(0, 0, _width, _height);
+}
+
+void FrameExporter::endFrame(int windowWidth, int windowHeight) {
+	// Ring full: the oldest readback was queued RING frames ago and is done by now
+	if (_inFlight == RING)
+		collect(_head, true);
+
+	int slot = _head;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo[slot]);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);	// async, into the PBO
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_slotFrame[slot] = _captured++;
+	_head = (_head + 1) % RING;
+	_inFlight++;
+
+	// Pick up every readback already finished, never wait here
+	while (_inFlight > 0 && _inFlight < RING) {
+		int oldest = (_head - _inFlight + RING) % RING;
+		GLenum state = glClientWaitSync(_fence[oldest], 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+			break;
+		collect(oldest, false);
+	}
+
+	// Preview in the window
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, _width, _height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowWidth, windowHeight);
+
+	if (_maxFrames > 0 && _captured >= static_cast<size_t>(_maxFrames))
+		stop();
+}
+
+void FrameExporter::collect(int slot, bool wait) {
+	if (wait)
+		glClientWaitSync(_fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 5'000'000'000ull);
+	glDeleteSync(_fence[slot]);
+	_fence[slot] = nullptr;
+	_inFlight--;
+
+	const size_t frameSize = static_cast<size_t>(_width) * _height * 4;
+	Frame frame;
+	frame.number = _slotFrame[slot];
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		// A video must not lose frames: wait for the encoder rather than drop
+		_cv.wait(lock, [this]() { return _queue.size() < 8; });
+		if (!_free.empty()) {
+			frame.rgba = std::move(_free.back());
+			_free.pop_back();
+		}
+	}
+	frame.rgba.resize(frameSize);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo[slot]);
+	void *src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, GL_MAP_READ_BIT);
+	if (src) {
+		std::memcpy(frame.rgba.data(), src, frameSize);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!src)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(std::move(frame));
+	}
+	_cv.notify_all();
+}
+
+void FrameExporter::workerLoop() {
+	for (;;) {
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+			if (_queue.empty())
+				return;
+			frame = std::move(_queue.front());
+			_queue.pop_front();
+		}
+		_cv.notify_all();
+
+		if (_format == ExportFormat::PNG)
+			writePng(frame);
+		else
+			writeY4m(frame);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_free.push_back(std::move(frame.rgba));
+	}
+}
+
+
+// Callback of the stb writer: the first short write is kept for the UI
+struct PngSink {
+	FILE*	file;
+	bool	ok;
+};
+
+static void writeSink(void *context, void *data, int size) {
+	PngSink *sink = static_cast<PngSink*>(context);
+	if (sink->ok && std::fwrite(data, 1, size, sink->file) != static_cast<size_t>(size))
+		sink->ok = false;
+}
+
+// RGB: the alpha of the FBO is blending leftovers. Compacted in place, rows
+// flipped by the writer since GL rows go bottom to top
+void FrameExporter::writePng(Frame &frame) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "_%05zu.png", frame.number);
+	const std::string path = _output + name;
+	FILE *f = std::fopen(path.c_str(), "wb");
+	if (!f) {
+		fail("Cannot create " + path);
+		return;
+	}
+
+	uint8_t *pixels = frame.rgba.data();
+	const size_t count = static_cast<size_t>(_width) * _height;
+	for (size_t i = 0; i < count; ++i) {
+		pixels[3 * i + 0] = pixels[4 * i + 0];
+		pixels[3 * i + 1] = pixels[4 * i + 1];
+		pixels[3 * i + 2] = pixels[4 * i + 2];
+	}
+
+	PngSink sink = {f, true};
+	const int encoded = stbi_write_png_to_func(writeSink, &sink, _width, _height, 3, pixels, _width * 3);
+	if (std::fclose(f) != 0)
+		sink.ok = false;
+	if (!encoded || !sink.ok)
+		fail("Failed to write " + path);
+}
+
+// Full range BT.601, planar Y U V, no chroma subsampling
+void FrameExporter::writeY4m(const Frame &frame) {
+	const size_t plane = static_cast<size_t>(_width) * _height;
+	std::vector<uint8_t> yuv(plane * 3);
+
+	for (int y = 0; y < _height; ++y) {
+		const uint8_t *src = frame.rgba.data() + static_cast<size_t>(_height - 1 - y) * _width * 4;
+		for (int x = 0; x < _width; ++x, src += 4) {
+			float r = src[0], g = src[1], bl = src[2];
+			size_t i = static_cast<size_t>(y) * _width + x;
+			yuv[i]             = static_cast<uint8_t>(std::min(255.0f, 0.299f * r + 0.587f * g + 0.114f * bl + 0.5f));
+			yuv[plane + i]     = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, 128.5f - 0.168736f * r - 0.331264f * g + 0.5f * bl)));
+			yuv[2 * plane + i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, 128.5f + 0.5f * r - 0.418688f * g - 0.081312f * bl)));
+		}
+	}
+	if (std::fputs("FRAME\n", _video) < 0 || std::fwrite(yuv.data(), 1, yuv.size(), _video) != yuv.size())
+		fail("Failed to write " + _output);
+}
+
+// Worker side: only the first failure is kept, the UI picks it up with checkError
+void FrameExporter::fail(const std::string &message) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_error.empty())
+		_error = message;
+}
+
+void FrameExporter::checkError() {
+	std::string message;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		message.swap(_error);
+	}
+	if (!message.empty())
+		throw fileError("   \033[33m" + message + "\033[0m");
+}
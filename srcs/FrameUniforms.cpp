@@ -0,0 +1,84 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FrameUniforms.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 18:49:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 18:49:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#include "FrameUniforms.hpp"
+#include "GlExtensions.hpp"
+
+#include <cstring>
+
+void bindFrameBlock(GLuint program) {
+	GLuint index = glGetUniformBlockIndex(program, "Frame");
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, FRAME_BINDING);
+}
+
+// Constructeur
+FrameUniforms::FrameUniforms(): _ubo(0), _stride(0), _mapped(nullptr), _slot(0), _fence{nullptr, nullptr, nullptr} {}
+
+FrameUniforms::~FrameUniforms() {
+	cleanup();
+}
+
+void FrameUniforms::init() {
+	GLint align = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+	_stride = static_cast<GLsizei>((sizeof(FrameData) + align - 1) / align * align);
+
+	glGenBuffers(1, &_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	if (glExt.bufferStorage) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, _stride * FRAME_RING, nullptr, flags);
+		_mapped = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, _stride * FRAME_RING, flags));
+		if (!_mapped)
+			throw openGlError("   \033[33mFailed to map the frame uniform buffer\033[0m");
+	} else
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::cleanup() {
+	for (GLsync &fence : _fence) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (_ubo) glDeleteBuffers(1, &_ubo);	// unmaps too
+	_ubo = 0;
+	_mapped = nullptr;
+}
+
+void FrameUniforms::upload(const FrameData &data) {
+	if (_mapped) {
+		// The slot written FRAME_RING frames ago: its fence is long signaled in practice
+		_slot = (_slot + 1) % FRAME_RING;
+		if (_fence[_slot]) {
+			glClientWaitSync(_fence[_slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(_fence[_slot]);
+			_fence[_slot] = nullptr;
+		}
+		std::memcpy(_mapped + _slot * _stride, &data, sizeof(data));
+		glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BINDING, _ubo, _slot * _stride, sizeof(FrameData));
+	} else {
+		// Orphaning: the driver hands out fresh storage, no wait on the previous frame
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, _ubo);
+	}
+}
+
+void FrameUniforms::endFrame() {
+	if (_mapped)
+		_fence[_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
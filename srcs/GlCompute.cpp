@@ -0,0 +1,153 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlCompute.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 20:49:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 20:49:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#include "GlCompute.hpp"
+#include "ParticleSystem.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// SSBO bindings of shaders/*_compute.glsl
+#define BIND_POS		0
+#define BIND_VEL		1
+#define BIND_COL		2
+#define BIND_GRAVITY	3
+
+static GLuint buildCompute(const char* path) {
+	std::ifstream file(path);
+	if (!file.is_open())
+		throw openGlError(std::string("   \033[33mCannot open shader file: ") + path + "\033[0m");
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string code = buffer.str();
+	const char* src = code.c_str();
+
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+	GLint ok = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		glDeleteShader(shader);
+		throw openGlError(std::string("   \033[33m") + path + ": " + log + "\033[0m");
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, shader);
+	glLinkProgram(program);
+	glDeleteShader(shader);
+	glGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		glDeleteProgram(program);
+		throw openGlError(std::string("   \033[33mFailed to link ") + path + "\033[0m");
+	}
+	return program;
+}
+
+static GLuint groups(GLuint count) {
+	return (count + COMPUTE_WG - 1) / COMPUTE_WG;
+}
+
+// Constructeur
+GlCompute::GlCompute(): _initProgram(0), _updateProgram(0), _gravity(0), _nGravity(0),
+	_initLoc{-1, -1, -1, -1, -1, -1, -1}, _updateLoc{-1, -1, -1, -1, -1, -1} {}
+
+GlCompute::~GlCompute() {
+	cleanup();
+}
+
+void GlCompute::init() {
+	if (!glExt.compute)
+		throw openGlError("   \033[33mThe GL compute backend needs OpenGL 4.3\033[0m");
+	_initProgram = buildCompute("shaders/init_compute.glsl");
+	_updateProgram = buildCompute("shaders/update_compute.glsl");
+
+	const char* initNames[] = {"uNbParticles", "uFirst", "uRadius", "uShape", "uNGravity", "uSpeed", "uSeed"};
+	for (int i = 0; i < 7; ++i)
+		_initLoc[i] = glGetUniformLocation(_initProgram, initNames[i]);
+	const char* updateNames[] = {"uNbParticles", "uDt", "uTime", "uNGravity", "uColorMode", "uSpeedScale"};
+	for (int i = 0; i < 6; ++i)
+		_updateLoc[i] = glGetUniformLocation(_updateProgram, updateNames[i]);
+
+	// Room for every source, rewritten in place
+	glGenBuffers(1, &_gravity);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _gravity);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GravityPoint) * STATS_MAX_GP, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GlCompute::cleanup() {
+	if (_gravity) glDeleteBuffers(1, &_gravity);
+	if (_updateProgram) glDeleteProgram(_updateProgram);
+	if (_initProgram) glDeleteProgram(_initProgram);
+	_gravity = _updateProgram = _initProgram = 0;
+}
+
+// Same std430 layout as the C++ struct: float, vec4 at 16, two ints, 48 bytes
+void GlCompute::setGravity(const std::vector<GravityPoint> &points) {
+	static_assert(sizeof(GravityPoint) == 48, "GravityPoint must match the std430 struct");
+	_nGravity = static_cast<GLuint>(std::min<size_t>(points.size(), STATS_MAX_GP));
+	if (!_nGravity)
+		return;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _gravity);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GravityPoint) * _nGravity, points.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Particles [first, count) only, like initShape with a global offset
+void GlCompute::initShape(GLuint pos, GLuint vel, GLuint first, GLuint count, float radius, int shape,
+	GLuint speed, GLuint seed) {
+	if (first >= count)
+		return;
+	glUseProgram(_initProgram);
+	glUniform1ui(_initLoc[0], count);
+	glUniform1ui(_initLoc[1], first);
+	glUniform1f(_initLoc[2], radius);
+	glUniform1i(_initLoc[3], shape);
+	glUniform1ui(_initLoc[4], _nGravity);
+	glUniform1ui(_initLoc[5], speed);
+	glUniform1ui(_initLoc[6], seed);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_POS, pos);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_VEL, vel);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_GRAVITY, _gravity);
+	glDispatchCompute(groups(count - first), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glUseProgram(0);
+}
+
+// One dispatch, then a barrier for whatever reads the buffers next:
+// the draw, the next step, a copy or a readback
+void GlCompute::update(GLuint pos, GLuint vel, GLuint col, GLuint count, float dt, float time,
+	GLuint colorMode, float speedScale) {
+	glUseProgram(_updateProgram);
+	glUniform1ui(_updateLoc[0], count);
+	glUniform1f(_updateLoc[1], dt);
+	glUniform1f(_updateLoc[2], time);
+	glUniform1ui(_updateLoc[3], _nGravity);
+	glUniform1ui(_updateLoc[4], colorMode);
+	glUniform1f(_updateLoc[5], speedScale);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_POS, pos);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_VEL, vel);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_COL, col);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIND_GRAVITY, _gravity);
+	glDispatchCompute(groups(count), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+		| GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	glUseProgram(0);
+}
@@ -0,0 +1,58 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   GlExtensions.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 12:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 21:34:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "GlExtensions.hpp"
+
+#include <cstring>
+
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = nullptr;
+PFNGLDRAWELEMENTSINDIRECTPROC glad_glDrawElementsIndirect = nullptr;
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+
+GlExtensions glExt;
+
+static bool atLeast(int major, int minor) {
+	return glExt.major > major || (glExt.major == major && glExt.minor >= minor);
+}
+
+bool hasGlExtension(const char *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const char *ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (ext && std::strcmp(ext, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+void loadGlExtensions(GLADloadproc load) {
+	glGetIntegerv(GL_MAJOR_VERSION, &glExt.major);
+	glGetIntegerv(GL_MINOR_VERSION, &glExt.minor);
+
+	if (atLeast(4, 4) || hasGlExtension("GL_ARB_buffer_storage")) {
+		glad_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(load("glBufferStorage"));
+		glExt.bufferStorage = glad_glBufferStorage != nullptr;
+	}
+	if (atLeast(4, 0) || hasGlExtension("GL_ARB_draw_indirect")) {
+		glad_glDrawElementsIndirect = reinterpret_cast<PFNGLDRAWELEMENTSINDIRECTPROC>(load("glDrawElementsIndirect"));
+		glExt.drawIndirect = glad_glDrawElementsIndirect != nullptr;
+	}
+	// Core 4.3 only: the shaders are GLSL 430, the extensions on an older
+	// context would not compile them
+	if (atLeast(4, 3)) {
+		glad_glDispatchCompute = reinterpret_cast<PFNGLDISPATCHCOMPUTEPROC>(load("glDispatchCompute"));
+		glad_glMemoryBarrier = reinterpret_cast<PFNGLMEMORYBARRIERPROC>(load("glMemoryBarrier"));
+		glExt.compute = glad_glDispatchCompute && glad_glMemoryBarrier;
+	}
+}
@@ -0,0 +1,204 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   HdrRenderer.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 17:49:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 19:19:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#include "HdrRenderer.hpp"
+#include "FrameUniforms.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static std::string readShader(const char* path) {
+	std::ifstream file(path);
+	if (!file.is_open())
+		throw openGlError(std::string("   \033[33mCannot open shader file: ") + path + "\033[0m");
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	return buffer.str();
+}
+
+static GLuint compileShader(GLenum type, const char* path) {
+	std::string code = readShader(path);
+	const char* src = code.c_str();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+
+	GLint ok = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		glDeleteShader(shader);
+		throw openGlError(std::string("   \033[33m") + path + ": " + log + "\033[0m");
+	}
+	return shader;
+}
+
+static GLuint linkProgram(const char* vPath, const char* fPath) {
+	GLuint vShader = compileShader(GL_VERTEX_SHADER, vPath);
+	GLuint fShader = compileShader(GL_FRAGMENT_SHADER, fPath);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vShader);
+	glAttachShader(program, fShader);
+	glLinkProgram(program);
+	glDeleteShader(vShader);
+	glDeleteShader(fShader);
+
+	GLint ok = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		glDeleteProgram(program);
+		throw openGlError(std::string("   \033[33mFailed to link ") + fPath + "\033[0m");
+	}
+	return program;
+}
+
+static GLuint createTarget(GLenum internal, GLenum format, int width, int height, bool mipmaps, GLuint &fbo) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, format, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (mipmaps)
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		throw openGlError("   \033[33mHDR framebuffer is incomplete\033[0m");
+	return texture;
+}
+
+// Constructeur
+HdrRenderer::HdrRenderer(): _enabled(false), _gain(0.05f), _key(0.18f), _adapted(false),
+	_width(0), _height(0), _levels(1), _previousFbo(0), _previousViewport{0, 0, 0, 0},
+	_fbo(0), _color(0), _lumFbo(0), _lum(0), _adaptFbo(0), _adapt(0), _vao(0),
+	_lumProgram(0), _adaptProgram(0), _tonemapProgram(0), _levelLoc(-1) {}
+
+HdrRenderer::~HdrRenderer() {
+	cleanup();
+}
+
+void HdrRenderer::init() {
+	_lumProgram     = linkProgram("shaders/screen_vertex.glsl", "shaders/luminance_fragment.glsl");
+	_adaptProgram   = linkProgram("shaders/screen_vertex.glsl", "shaders/adapt_fragment.glsl");
+	_tonemapProgram = linkProgram("shaders/screen_vertex.glsl", "shaders/tonemap_fragment.glsl");
+	glGenVertexArrays(1, &_vao);
+
+	// Samplers never move: set once, the exposure comes from the Frame block
+	bindFrameBlock(_tonemapProgram);
+	glUseProgram(_lumProgram);
+	glUniform1i(glGetUniformLocation(_lumProgram, "uHdr"), 0);
+	glUseProgram(_adaptProgram);
+	glUniform1i(glGetUniformLocation(_adaptProgram, "uLum"), 0);
+	_levelLoc = glGetUniformLocation(_adaptProgram, "uLevel");
+	glUseProgram(_tonemapProgram);
+	glUniform1i(glGetUniformLocation(_tonemapProgram, "uHdr"), 0);
+	glUniform1i(glGetUniformLocation(_tonemapProgram, "uAdapt"), 1);
+	glUseProgram(0);
+
+	_adapt = createTarget(GL_R16F, GL_RED, 1, 1, false, _adaptFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HdrRenderer::releaseTargets() {
+	if (_fbo) glDeleteFramebuffers(1, &_fbo);
+	if (_lumFbo) glDeleteFramebuffers(1, &_lumFbo);
+	if (_color) glDeleteTextures(1, &_color);
+	if (_lum) glDeleteTextures(1, &_lum);
+	_fbo = _lumFbo = _color = _lum = 0;
+	_width = _height = 0;
+}
+
+void HdrRenderer::cleanup() {
+	releaseTargets();
+	if (_adaptFbo) glDeleteFramebuffers(1, &_adaptFbo);
+	if (_adapt) glDeleteTextures(1, &_adapt);
+	if (_vao) glDeleteVertexArrays(1, &_vao);
+	if (_lumProgram) glDeleteProgram(_lumProgram);
+	if (_adaptProgram) glDeleteProgram(_adaptProgram);
+	if (_tonemapProgram) glDeleteProgram(_tonemapProgram);
+	_adaptFbo = _adapt = _vao = _lumProgram = _adaptProgram = _tonemapProgram = 0;
+}
+
+void HdrRenderer::resize(int width, int height) {
+	releaseTargets();
+	_color = createTarget(GL_RGBA16F, GL_RGBA, width, height, false, _fbo);
+	_lum = createTarget(GL_RG16F, GL_RG, width, height, true, _lumFbo);
+	_levels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+	_width = width;
+	_height = height;
+}
+
+void HdrRenderer::begin(int width, int height) {
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFbo);
+	glGetIntegerv(GL_VIEWPORT, _previousViewport);
+	if (width != _width || height != _height)
+		resize(width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+	glViewport(0, 0, _width, _height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);		// nothing hides anything, and no depth writes
+}
+
+void HdrRenderer::resolve(float dt) {
+	glBindVertexArray(_vao);
+
+	// 1 Log luminance of the covered pixels, averaged down to the last mip level
+	glBindFramebuffer(GL_FRAMEBUFFER, _lumFbo);
+	glUseProgram(_lumProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _color);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindTexture(GL_TEXTURE_2D, _lum);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// 2 Adapted luminance: blended toward the new average, rate from dt
+	float rate = _adapted ? 1.0f - std::exp(-dt * HDR_ADAPT_SPEED) : 1.0f;
+	_adapted = true;
+	glBindFramebuffer(GL_FRAMEBUFFER, _adaptFbo);
+	glViewport(0, 0, 1, 1);
+	glEnable(GL_BLEND);
+	glBlendColor(0.0f, 0.0f, 0.0f, rate);
+	glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+	glUseProgram(_adaptProgram);
+	glUniform1f(_levelLoc, static_cast<float>(_levels - 1));
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDisable(GL_BLEND);
+
+	// 3 Exposure and tonemap into the target of the frame
+	glBindFramebuffer(GL_FRAMEBUFFER, _previousFbo);
+	glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+	glUseProgram(_tonemapProgram);
+	glBindTexture(GL_TEXTURE_2D, _color);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, _adapt);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+}
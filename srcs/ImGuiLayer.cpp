@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2026/01/09 14:18:57 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/19 11:43:23 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 02:19:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -51,11 +51,25 @@ void ImGuiLayer::beginFrame() {
 	ImGui::Text
 */
 // Render ImGui draw data
-void ImGuiLayer::render(ParticleSystem& system, CameraMode& cameraMode, CameraOrbit& cameraOrbit) {
+void ImGuiLayer::render(ParticleSystem& system, CameraMode& cameraMode, CameraOrbit& cameraOrbit,
+	TrajectoryRecorder& recorder, TrajectoryPlayer& player, FrameExporter& exporter, HdrRenderer& hdr,
+	std::string& deviceRequest) {
 	ImGui::Begin("Particle System Controls");
 
 	renderCamera(cameraMode, cameraOrbit);
-	renderPS(system);
+	renderDevice(system, deviceRequest);
+	renderPS(system, player.isOpen());
+	renderHdr(hdr);
+	renderStats(system, cameraOrbit);
+	// The player writes the recorded count: nothing may resize the buffers under it
+	ImGui::BeginDisabled(player.isOpen());
+	renderSnapshot(system);
+	renderPointCloud(system);
+	ImGui::EndDisabled();
+	renderVectorField(system);
+	renderStreaming(system);
+	renderTrajectory(system, recorder, player);
+	renderExport(exporter);
 
 	ImGui::End();
 	
@@ -64,23 +78,132 @@ void ImGuiLayer::render(ParticleSystem& system, CameraMode& cameraMode, CameraOr
 
 static int editingIndex = -1;
 
-void ImGuiLayer::renderPS(ParticleSystem& system) {
+// The switch itself is done by Application, between two frames
+void ImGuiLayer::renderDevice(ParticleSystem& system, std::string& deviceRequest) {
+	static std::vector<ClDeviceInfo> devices = listClDevices();
+	const ClDeviceInfo &current = system.getDevice();
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "OpenCL device");
+	const char* currentLabel = system.isGlCompute() ? GL_COMPUTE_LABEL : current.label().c_str();
+	if (ImGui::BeginCombo("Device", currentLabel)) {
+		if (glExt.compute && ImGui::Selectable(GL_COMPUTE_LABEL, system.isGlCompute()) && !system.isGlCompute())
+			deviceRequest = GL_COMPUTE_LABEL;
+		for (const ClDeviceInfo &dev : devices) {
+			bool selected = !system.isGlCompute() && dev.device == current.device;
+			std::string label = dev.label() + (dev.glSharing ? "" : " (no GL sharing)");
+			if (ImGui::Selectable(label.c_str(), selected) && !selected)
+				deviceRequest = dev.label();
+		}
+		ImGui::EndCombo();
+	}
+	if (system.isGlCompute())
+		ImGui::Text("%s, no OpenCL context", current.name.c_str());
+	else
+		ImGui::Text("%s, %u compute units, %llu MB", system.isInterop() ? "GL sharing" : "copy path",
+			current.computeUnits, static_cast<unsigned long long>(current.globalMem >> 20));
+
+	if (system.canCull())
+	{
+		ImGui::Checkbox("Frustum culling (indirect draw)", &system.cullEnabled());
+		ImGui::Text("Level of detail:"); ImGui::SameLine();
+		ImGui::RadioButton("Off", &system.getLodMode(), 0); ImGui::SameLine();
+		ImGui::RadioButton("Screen size", &system.getLodMode(), 1); ImGui::SameLine();
+		ImGui::RadioButton("Frame time", &system.getLodMode(), 2);
+		if (system.getLodMode() == 1)
+			ImGui::SliderFloat("Particles / pixel", &system.lodDensity(), 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+		else if (system.getLodMode() == 2)
+			ImGui::SliderFloat("Target (ms)", &system.lodTargetMs(), 5.0f, 50.0f, "%.1f");
+		if (system.getLodMode() != 0)
+			ImGui::Text("Drawn: %.1f %%, point %.0f px, alpha %.2f", system.getLodFraction() * 100.0f,
+				system.getPointSize(), system.getPointAlpha());
+
+		ImGui::Text("Depth sort:"); ImGui::SameLine();
+		ImGui::RadioButton("None", &system.getSortMode(), 0); ImGui::SameLine();
+		ImGui::RadioButton("Exact", &system.getSortMode(), 1); ImGui::SameLine();
+		ImGui::RadioButton("Approximate", &system.getSortMode(), 2);
+	} else
+		ImGui::TextDisabled("Frustum culling: needs GL sharing and GL 4.0");
+	ImGui::SliderFloat("Point size", &system.basePointSize(), 1.0f, LOD_MAX_POINT, "%.0f px");
+	ImGui::Checkbox("Soft sprites", &system.softSprites());
+
+	// Trails: the ring is reallocated once a slider is released
+	if (system.canTrail()) {
+		static int trailCount = 1024;
+		static int trailLength = 64;
+		bool trails = system.getTrailCount() > 0;
+		if (ImGui::Checkbox("Trails", &trails))
+			system.setTrails(trails ? trailCount : 0, trailLength);
+		if (trails) {
+			ImGui::SliderInt("Trail count", &trailCount, 16, TRAIL_MAX_COUNT, "%d", ImGuiSliderFlags_Logarithmic);
+			bool apply = ImGui::IsItemDeactivatedAfterEdit();
+			ImGui::SliderInt("Trail length", &trailLength, 4, TRAIL_MAX_LENGTH);
+			apply |= ImGui::IsItemDeactivatedAfterEdit();
+			if (apply)
+				system.setTrails(trailCount, trailLength);
+			ImGui::SliderFloat("Trail alpha", &system.trailAlpha(), 0.05f, 1.0f, "%.2f");
+		}
+	} else
+		ImGui::TextDisabled("Trails: need GL sharing");
+
+	for (const Partition &p : system.getPartitions())
+		ImGui::BulletText("%s: %zu particles from %zu", p.label.c_str(), p.count, p.offset);
+
+	// Live objects, see Resources.hpp
+	const ResourceCounters &rc = resourceCounters();
+	ImGui::Text("CL: %ld buffers (%lld MB), %ld kernels, %ld queues", rc.buffers.load(),
+		rc.bufferBytes.load() >> 20, rc.kernels.load(), rc.queues.load());
+	ImGui::Text("GL: %ld buffers (%lld MB), pool: %zu free (%zu MB)", rc.glBuffers.load(),
+		rc.glBufferBytes.load() >> 20, system.getPool().pooledBuffers(), system.getPool().pooledBytes() >> 20);
+	const DeviceArena &arena = system.getArena();
+	ImGui::Text("Arena: %zu KB, %zu KB persistent, %zu KB scratch", arena.capacity() >> 10,
+		arena.persistentBytes() >> 10, arena.scratchPeak() >> 10);
+}
+
+void ImGuiLayer::renderHdr(HdrRenderer& hdr) {
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Rendering");
+	ImGui::Checkbox("HDR density (additive, tonemapped)", &hdr.enabled());
+	if (hdr.enabled()) {
+		ImGui::SliderFloat("Particle weight", &hdr.gain(), 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+		ImGui::SliderFloat("Exposure key", &hdr.key(), 0.02f, 1.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+	}
+}
+
+void ImGuiLayer::renderPS(ParticleSystem& system, bool countLocked) {
 
 	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "General information");
 	ImGui::Text("			Radius: %f, ", system.getRadius()); ImGui::SameLine();
 	auto& gPoint = system.getGravityPoint();
 	ImGui::Text("Gravity Centers: %d / 8", system.getNGravityPos());
 	
-	static int uiType = 0; // 0 gravity, 1 Lorentz, 2 Curl noise, 3 repulsion
+	static int uiType = 0; // 0 gravity, 1 Lorentz, 2 Curl noise, 3 repulsion, 4 vector field
 	ImGui::Text("Physic model:");
 	ImGui::RadioButton("Gravity", &uiType, 0); ImGui::SameLine();
 	ImGui::RadioButton("Lorentz", &uiType, 1); ImGui::SameLine();
 	ImGui::RadioButton("Curl noise", &uiType, 2); ImGui::SameLine();
-	ImGui::RadioButton("Repulsion", &uiType, 3);
+	ImGui::RadioButton("Repulsion", &uiType, 3); ImGui::SameLine();
+	ImGui::RadioButton("Vector field", &uiType, 4);
 	// Type de gravité
 	bool typeChanged = false;
 	if (uiType != system.getGravityPoint()[0]._type) typeChanged = true;
 	if (typeChanged)   system.setType(uiType);
+	if (system.hasNoiseVolume())
+		ImGui::Checkbox("Baked curl noise (tileable volume)", &system.bakedNoise());
+	if (system.hasForceField()) {
+		// Gravity and repulsion sources sampled from a grid around the cloud
+		ImGui::Checkbox("Baked force field", &system.forceField());
+		if (system.fieldLive()) {
+			ImGui::SameLine();
+			ImGui::Text("error: max %.1f%%, mean %.2f%% (%u bakes)", system.getFieldMaxError() * 100.0f,
+				system.getFieldMeanError() * 100.0f, system.getFieldBakes());
+		}
+	}
+
+	// The display keeps its rate, positions are interpolated between two steps
+	ImGui::Text("Simulation rate:"); ImGui::SameLine();
+	ImGui::RadioButton("Every frame", &system.stepRate(), 0); ImGui::SameLine();
+	ImGui::RadioButton("30 Hz", &system.stepRate(), 30); ImGui::SameLine();
+	ImGui::RadioButton("60 Hz", &system.stepRate(), 60); ImGui::SameLine();
+	ImGui::RadioButton("120 Hz", &system.stepRate(), 120);
 	
 	
 	for (int i = 0; i < gPoint.size(); ++i) {
@@ -159,18 +282,88 @@ void ImGuiLayer::renderPS(ParticleSystem& system) {
 
 	// Variables ImGui
 	static int  uiPartCount = system.getNPart();
-	static int  uiShape     = system.getShape();   // 0 sphere, 1 cube, 2 pyramid
+	static int  uiShape     = system.getShape();   // 0 sphere, 1 cube, 2 pyramid, 3 mesh, 4 mesh volume, 5 image, 6 relief
 	static int  uiSpeed     = 1;
 	static float uiRadius   = system.getRadius();
 
-	// Slider & widgets avec retour booléen
-	bool partChanged   = ImGui::SliderInt("Particle count", &uiPartCount, 1, 3'500'000);
-	bool radiusChanged = ImGui::SliderFloat("Radius", &uiRadius, 1, 250);
+	// Count and radius apply when the slider settles: released, or held still for a moment
+	static double partEdit = 0.0, radiusEdit = 0.0;
+	const double now = ImGui::GetTime();
+	if (countLocked)
+		uiPartCount = static_cast<int>(system.getNPart());
+	ImGui::BeginDisabled(countLocked);
+	if (ImGui::SliderInt("Particle count", &uiPartCount, 1, 3'500'000))
+		partEdit = now;
+	ImGui::EndDisabled();
+	bool partChanged = uiPartCount != static_cast<int>(system.getNPart())
+		&& (ImGui::IsItemDeactivatedAfterEdit() || (ImGui::IsItemActive() && now - partEdit > 0.3));
+	ImGui::SameLine();
+	ImGui::TextDisabled("(%.1fM allocated)", system.getCapacity() / 1e6);
+
+	if (ImGui::SliderFloat("Radius", &uiRadius, 1, 250))
+		radiusEdit = now;
+	bool radiusChanged = uiRadius != system.getRadius()
+		&& (ImGui::IsItemDeactivatedAfterEdit() || (ImGui::IsItemActive() && now - radiusEdit > 0.3));
 
 	bool shapeChanged = false;
 	if (ImGui::RadioButton("Sphere",  &uiShape, 0)) shapeChanged = true; ImGui::SameLine();
 	if (ImGui::RadioButton("Cube",    &uiShape, 1)) shapeChanged = true; ImGui::SameLine();
 	if (ImGui::RadioButton("Pyramid", &uiShape, 2)) shapeChanged = true;
+	if (system.hasMesh()) {
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Mesh",        &uiShape, 3)) shapeChanged = true;
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Mesh volume", &uiShape, 4)) shapeChanged = true;
+	}
+	if (system.hasPicture()) {
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Image",  &uiShape, 5)) shapeChanged = true;
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Relief", &uiShape, 6)) shapeChanged = true;
+	}
+
+	// OBJ surface or volume, parsed on every CPU thread
+	if (!system.isGlCompute()) {
+		static char meshPath[256] = "resources/42.obj";
+		static std::string meshStatus;
+		ImGui::InputText("OBJ##mesh", meshPath, sizeof(meshPath));
+		ImGui::SameLine();
+		if (ImGui::Button("Load##mesh")) {
+			try {
+				system.loadMesh(meshPath);
+				meshStatus = std::to_string(system.getMeshTriangles()) + " triangles in "
+					+ std::to_string(static_cast<int>(system.getMeshLoadMs())) + " ms";
+				uiShape = 3;
+				shapeChanged = true;
+			} catch (fileError &e) {
+				meshStatus = e.what();
+			}
+		}
+		if (!meshStatus.empty())
+			ImGui::TextUnformatted(meshStatus.c_str());
+	}
+
+	// Picture sampled by luminance on the device, the particles take its colors
+	if (!system.isGlCompute() && system.hasForceField()) {
+		static char picturePath[256] = "resources/42.png";
+		static std::string pictureStatus;
+		ImGui::InputText("Image##picture", picturePath, sizeof(picturePath));
+		ImGui::SameLine();
+		if (ImGui::Button("Load##picture")) {
+			try {
+				system.loadPicture(picturePath);
+				pictureStatus = std::to_string(system.getPictureWidth()) + "x" + std::to_string(system.getPictureHeight())
+					+ " in " + std::to_string(static_cast<int>(system.getPictureLoadMs())) + " ms";
+				uiShape = 5;
+				shapeChanged = true;
+				system.setColorMode(3);
+			} catch (fileError &e) {
+				pictureStatus = e.what();
+			}
+		}
+		if (!pictureStatus.empty())
+			ImGui::TextUnformatted(pictureStatus.c_str());
+	}
 
 	bool speedChanged = false;
 	speedChanged |= ImGui::RadioButton("Static",    &uiSpeed, 1); ImGui::SameLine();
@@ -179,31 +372,292 @@ void ImGuiLayer::renderPS(ParticleSystem& system) {
 	speedChanged |= ImGui::RadioButton("Linear",    &uiSpeed, 4);
 
 
-	// Si une valeur a changé, update directement
-	if (partChanged || radiusChanged || shapeChanged || speedChanged) {
+	// A new count only appends (or drops) particles, the others restart the shape
+	if (partChanged)
+		system.setNbPart(uiPartCount);
+	if (radiusChanged || shapeChanged || speedChanged) {
 		if (speedChanged)  system.setSpeed(uiSpeed);
-		if (partChanged)   system.setNbPart(uiPartCount);
 		if (radiusChanged) system.setRadius(uiRadius);
 
 		switch (uiShape) {
 			case 0: system.initializeShape("sphere");  break;
 			case 1: system.initializeShape("cube");    break;
 			case 2: system.initializeShape("pyramid"); break;
+			case 3: system.initializeShape("mesh");    break;
+			case 4: system.initializeShape("volume");  break;
+			case 5: system.initializeShape("image");   break;
+			case 6: system.initializeShape("relief");  break;
 		}
 	}
 
 	
-	static int uiColor = 0;
-	ImGui::RadioButton("Color 1", &uiColor, 0); ImGui::SameLine();
-	ImGui::RadioButton("Color 2", &uiColor, 1); ImGui::SameLine();
-	ImGui::RadioButton("Color 3", &uiColor, 2);
-	
-	system.setColorMode(uiColor);
+	ImGui::RadioButton("Color 1", &system.getColorMode(), 0); ImGui::SameLine();
+	ImGui::RadioButton("Color 2", &system.getColorMode(), 1); ImGui::SameLine();
+	ImGui::RadioButton("Color 3", &system.getColorMode(), 2);
+	if (system.hasLoadedColors()) {
+		ImGui::SameLine();
+		ImGui::RadioButton("Loaded colors", &system.getColorMode(), 3);
+	}
 
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 
 		1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 }
 
+void ImGuiLayer::renderStats(ParticleSystem& system, CameraOrbit& cameraOrbit) {
+	static bool autoFrame = false;
+	const SimStats& stats = system.getStats();
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Statistics");
+	if (!stats.valid) {
+		ImGui::Text("Waiting for the first reduction...");
+		return;
+	}
+	ImGui::Text("Box min: %.1f %.1f %.1f  max: %.1f %.1f %.1f",
+		stats.bmin.x, stats.bmin.y, stats.bmin.z, stats.bmax.x, stats.bmax.y, stats.bmax.z);
+	ImGui::Text("Center of mass: %.2f %.2f %.2f  spread: %.2f",
+		stats.center.x, stats.center.y, stats.center.z, stats.spread);
+	ImGui::Text("Kinetic: %.4g  Potential: %.4g  Total: %.4g",
+		stats.kinetic, stats.potential, stats.kinetic + stats.potential);
+
+	char overlay[64];
+	std::snprintf(overlay, sizeof(overlay), "max %.2f  p95 %.2f", stats.maxSpeed, stats.speedP95);
+	ImGui::PlotHistogram("Speed", stats.hist, STATS_BINS, 0, overlay, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+	const auto& gPoint = system.getGravityPoint();
+	for (size_t i = 0; i < gPoint.size() && i < STATS_MAX_GP; ++i)
+		ImGui::Text("Captured by center %zu: %u", i, stats.captured[i]);
+
+	ImGui::Checkbox("Adaptive colors", &system.autoSpeedScale());
+	ImGui::SameLine();
+	ImGui::Text("(hot at speed %.2f)", system.getSpeedScale());
+
+	// The RMS spread ignores the few particles flung far away, the box does not
+	float radius = std::min(2.0f * stats.spread, 0.5f * glm::length(stats.bmax - stats.bmin));
+	if (ImGui::Button("Frame cloud"))
+		cameraOrbit.frame(stats.center, radius);
+	ImGui::SameLine();
+	ImGui::Checkbox("Auto frame", &autoFrame);
+	if (autoFrame)
+		cameraOrbit.frame(stats.center, radius, 0.05f);
+}
+
+void ImGuiLayer::renderSnapshot(ParticleSystem& system) {
+	static char path[256] = "snapshot.psnap";
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Snapshot");
+	ImGui::InputText("File##snapshot", path, sizeof(path));
+
+	int seed = static_cast<int>(system.getSeed());
+	if (ImGui::InputInt("Seed", &seed))
+		system.setSeed(static_cast<uint32_t>(seed));
+
+	try {
+		if (ImGui::Button("Save")) {
+			system.saveSnapshot(path);
+			status = std::string("Saved ") + path;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) {
+			system.loadSnapshot(path);
+			status = std::string("Loaded ") + path;
+		}
+	} catch (fileError &e) {
+		status = e.what();
+	}
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
+// LiDAR scans and outputs of other simulations as the starting state
+void ImGuiLayer::renderPointCloud(ParticleSystem& system) {
+	static char path[256] = "cloud.ply";
+	static int stride = 3;
+	static bool fit = true;
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Point cloud");
+	ImGui::InputText("File##cloud", path, sizeof(path));
+	ImGui::SameLine();
+	try {
+		if (ImGui::Button("Load##cloud")) {
+			system.loadPointCloud(path, stride, fit ? system.getRadius() : 0.0f);
+			status = std::to_string(system.getNPart()) + " points in "
+				+ std::to_string(static_cast<int>(system.getCloudLoadMs())) + " ms";
+		}
+	} catch (fileError &e) {
+		status = e.what();
+	} catch (openClError &e) {
+		status = e.what();
+	}
+	ImGui::Checkbox("Fit to radius##cloud", &fit);
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(100.0f);
+	ImGui::InputInt("Raw floats per point", &stride);		// 3, 4, 6 or 9, PLY files ignore it
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
+// Wind and flow fields authored elsewhere, placed by the "Vector field" sources
+void ImGuiLayer::renderVectorField(ParticleSystem& system) {
+	if (!system.hasForceField())
+		return;		// no image support
+	static char path[256] = "field.fga";
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Vector field");
+	ImGui::InputText("File##vfield", path, sizeof(path));
+	ImGui::SameLine();
+	try {
+		if (ImGui::Button("Load##vfield")) {
+			system.loadVectorField(path);
+			const cl_uint* size = system.getVectorFieldSize();
+			status = std::string("Loaded ") + path + " (" + std::to_string(size[0]) + "x"
+				+ std::to_string(size[1]) + "x" + std::to_string(size[2]) + ")";
+		}
+	} catch (fileError &e) {
+		status = e.what();
+	} catch (openClError &e) {
+		status = e.what();
+	}
+	if (system.hasVectorField()) {
+		ImGui::SliderFloat("Scale##vfield", &system.vectorFieldScale(), 0.1f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+		ImGui::SliderFloat("Falloff##vfield", &system.vectorFieldFalloff(), 0.0f, 200.0f, "%.0f");
+	}
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
+void ImGuiLayer::renderStreaming(ParticleSystem& system) {
+	static char path[256] = "field.pstream";
+	static int millions = 500;
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Out-of-core streaming");
+	ImGui::InputText("File##stream", path, sizeof(path));
+
+	try {
+		if (!system.isStreaming()) {
+			ImGui::InputInt("Millions of particles", &millions);
+			millions = std::max(1, std::min(millions, 4000));
+			if (ImGui::Button("Create")) {
+				system.startStreaming(path, static_cast<uint64_t>(millions) * 1000000ull);
+				status.clear();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Resume")) {
+				system.startStreaming(path, 0);
+				status.clear();
+			}
+		} else {
+			const StreamState &st = *system.getStream();
+			ImGui::Text("%.1fM particles, step %u, chunk %zu / %zu",
+				st.header.nbParticle / 1e6, st.header.steps, st.next, st.nChunks);
+			ImGui::Text("%zu chunks per frame, 1 rendered every %zu", st.chunksPerFrame, st.stride);
+			if (st.lastPass > 0.0)
+				ImGui::Text("Last pass: %.2f s, %.2f GB/s", st.lastPass,
+					st.header.nbParticle * 4.0 * sizeof(cl_float4) / st.lastPass / 1e9);
+			if (ImGui::Button("Stop##stream"))
+				system.stopStreaming();
+		}
+	} catch (std::exception &e) {
+		status = e.what();
+	}
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
+void ImGuiLayer::renderTrajectory(ParticleSystem& system, TrajectoryRecorder& recorder, TrajectoryPlayer& player) {
+	static char path[256] = "run.ptraj";
+	static int stepInterval = 4;
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Trajectory");
+	ImGui::InputText("File##trajectory", path, sizeof(path));
+
+	try {
+		if (!recorder.isRecording()) {
+			ImGui::SliderInt("Record every K steps", &stepInterval, 1, 64);
+			if (!player.isOpen() && ImGui::Button("Record")) {
+				recorder.start(path, system.getNPart(), static_cast<uint32_t>(stepInterval));
+				status.clear();
+			}
+		} else {
+			if (ImGui::Button("Stop recording"))
+				recorder.stop();
+			ImGui::SameLine();
+			ImGui::Text("%zu frames, %.1f MB, %zu dropped", recorder.getFrames(),
+				recorder.getBytes() / (1024.0 * 1024.0), recorder.getDropped());
+		}
+
+		if (!player.isOpen()) {
+			if (!recorder.isRecording() && ImGui::Button("Play")) {
+				player.open(path, system);
+				player.playing() = true;
+				status.clear();
+			}
+		} else {
+			// Scrubbing only decodes from the nearest keyframe
+			int frame = static_cast<int>(player.getFrame());
+			if (ImGui::SliderInt("Frame", &frame, 0, static_cast<int>(player.getFrameCount()) - 1))
+				player.seek(static_cast<size_t>(frame), system);
+			ImGui::Text("t = %.2f s", player.getFrameTime(player.getFrame()));
+			ImGui::SameLine();
+			ImGui::Checkbox("Playing", &player.playing());
+			ImGui::SameLine();
+			ImGui::SliderFloat("Rate", &player.rate(), 0.1f, 8.0f);
+			if (ImGui::Button("Back to simulation"))
+				player.close();
+		}
+	} catch (fileError &e) {
+		status = e.what();
+	}
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
+void ImGuiLayer::renderExport(FrameExporter& exporter) {
+	static char output[256] = "frame";
+	static int size[2] = {1920, 1080};
+	static int fps = 60;
+	static int maxFrames = 0;
+	static int format = 0;		// 0 PNG, 1 Y4M
+	static std::string status;
+
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Render to disk");
+	if (!exporter.isActive()) {
+		ImGui::InputText("Output##export", output, sizeof(output));
+		ImGui::InputInt2("Resolution", size);
+		ImGui::InputInt("Fps##export", &fps);
+		ImGui::InputInt("Frames (0 = until stop)", &maxFrames);
+		ImGui::RadioButton("PNG sequence", &format, 0); ImGui::SameLine();
+		ImGui::RadioButton("Y4M video", &format, 1);
+
+		if (ImGui::Button("Start export")) {
+			try {
+				exporter.start(output, size[0], size[1], format == 0 ? ExportFormat::PNG : ExportFormat::Y4M,
+					fps, maxFrames);
+				status.clear();
+			} catch (std::exception &e) {
+				status = e.what();
+			}
+		}
+	} else {
+		ImGui::Text("Exporting %dx%d: %zu frames", exporter.getWidth(), exporter.getHeight(), exporter.getFrames());
+		if (ImGui::Button("Stop export"))
+			exporter.stop();
+	}
+	// Files are written by the worker: its failures show up a frame or two later
+	try {
+		exporter.checkError();
+	} catch (fileError &e) {
+		status = e.what();
+		exporter.stop();
+	}
+	if (!status.empty())
+		ImGui::TextUnformatted(status.c_str());
+}
+
 void ImGuiLayer::renderCamera(CameraMode& cameraMode, CameraOrbit& cameraOrbit) {
 	const char* items[] = { "Orbit", "Fps" };
 	static int current_item = (cameraMode == CameraMode::ORBIT) ? 0 : 1;
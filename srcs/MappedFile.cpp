@@ -0,0 +1,128 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MappedFile.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 09:19:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 14:49:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Constructeur
+MappedFile::MappedFile(): _fd(-1), _data(nullptr), _size(0), _writable(false) {}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+void MappedFile::open(const std::string &path) {
+	close();
+	_fd = ::open(path.c_str(), O_RDONLY);
+	if (_fd < 0)
+		throw fileError("   \033[33mCannot open " + path + "\033[0m");
+
+	struct stat st;
+	if (fstat(_fd, &st) < 0 || st.st_size == 0) {
+		close();
+		throw fileError("   \033[33mEmpty or unreadable file " + path + "\033[0m");
+	}
+	_size = static_cast<size_t>(st.st_size);
+
+	_data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+	if (_data == MAP_FAILED) {
+		_data = nullptr;
+		close();
+		throw fileError("   \033[33mFailed to map " + path + "\033[0m");
+	}
+	// Every reader walks the file front to back: let the kernel read ahead
+	madvise(_data, _size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::create(const std::string &path, size_t size) {
+	close();
+	_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (_fd < 0)
+		throw fileError("   \033[33mCannot create " + path + "\033[0m");
+
+	if (ftruncate(_fd, static_cast<off_t>(size)) < 0) {
+		close();
+		throw fileError("   \033[33mCannot resize " + path + "\033[0m");
+	}
+	_size = size;
+	_writable = true;
+
+	_data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if (_data == MAP_FAILED) {
+		_data = nullptr;
+		close();
+		throw fileError("   \033[33mFailed to map " + path + "\033[0m");
+	}
+}
+
+void MappedFile::openShared(const std::string &path) {
+	close();
+	_fd = ::open(path.c_str(), O_RDWR);
+	if (_fd < 0)
+		throw fileError("   \033[33mCannot open " + path + "\033[0m");
+
+	struct stat st;
+	if (fstat(_fd, &st) < 0 || st.st_size == 0) {
+		close();
+		throw fileError("   \033[33mEmpty or unreadable file " + path + "\033[0m");
+	}
+	_size = static_cast<size_t>(st.st_size);
+	_writable = true;
+
+	_data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if (_data == MAP_FAILED) {
+		_data = nullptr;
+		close();
+		throw fileError("   \033[33mFailed to map " + path + "\033[0m");
+	}
+}
+
+// madvise wants page aligned ranges
+static void pageRange(size_t &offset, size_t &length, size_t size) {
+	const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t end = std::min(offset + length, size);
+	offset = offset / page * page;
+	length = end > offset ? end - offset : 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) {
+	if (!_data) return;
+	pageRange(offset, length, _size);
+	madvise(data() + offset, length, MADV_WILLNEED);
+}
+
+// Shared mappings keep the data in the page cache, it is written back later
+void MappedFile::evict(size_t offset, size_t length) {
+	if (!_data) return;
+	pageRange(offset, length, _size);
+	madvise(data() + offset, length, MADV_DONTNEED);
+}
+
+void MappedFile::close() {
+	if (_data) {
+		if (_writable) msync(_data, _size, MS_SYNC);
+		munmap(_data, _size);
+		_data = nullptr;
+	}
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+	_size = 0;
+	_writable = false;
+}
@@ -0,0 +1,400 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Mesh.cpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 23:09:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 02:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Piece of the file on line boundaries. Counts from the first pass, offsets
+// into the shared arrays from their prefix sums
+struct ObjChunk {
+	const char*	begin = nullptr;
+	const char*	end = nullptr;
+	size_t		vertices = 0;
+	size_t		triangles = 0;
+	size_t		firstVertex = 0;
+	size_t		firstTriangle = 0;
+	glm::vec3	bmin = glm::vec3(INFINITY);
+	glm::vec3	bmax = glm::vec3(-INFINITY);
+	bool		bad = false;
+};
+
+bool isObjPath(const std::string &path) {
+	if (path.size() < 4)
+		return false;
+	std::string ext = path.substr(path.size() - 4);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	return ext == ".obj";
+}
+
+static bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipBlank(const char* p, const char* end) {
+	while (p < end && isBlank(*p)) ++p;
+	return p;
+}
+
+static const char* lineEnd(const char* p, const char* end) {
+	const void* nl = std::memchr(p, '\n', end - p);
+	return nl ? static_cast<const char*>(nl) : end;
+}
+
+// Hand written: strtof could read past the end of the mapping, and is the
+// bottleneck of a scan of several hundred MB
+static const char* parseFloat(const char* p, const char* end, float &out, bool &ok) {
+	p = skipBlank(p, end);
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	const char* digits = p;
+	double v = 0.0;
+	while (p < end && std::isdigit(static_cast<unsigned char>(*p)))
+		v = v * 10.0 + (*p++ - '0');
+	if (p < end && *p == '.') {
+		double scale = 0.1;
+		for (++p; p < end && std::isdigit(static_cast<unsigned char>(*p)); ++p, scale *= 0.1)
+			v += (*p - '0') * scale;
+	}
+	if (p == digits) {
+		ok = false;
+		return p;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		++p;
+		bool negExp = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negExp = *p++ == '-';
+		int e = 0;
+		while (p < end && std::isdigit(static_cast<unsigned char>(*p)))
+			e = std::min(e * 10 + (*p++ - '0'), 400);
+		v *= std::pow(10.0, negExp ? -e : e);
+	}
+	out = static_cast<float>(neg ? -v : v);
+	return p;
+}
+
+// Vertex index of a face token ("7", "7/2", "7//3", "-1/..."), the rest of the token skipped
+static const char* parseIndex(const char* p, const char* end, long &out, bool &ok) {
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	const char* digits = p;
+	long v = 0;
+	while (p < end && std::isdigit(static_cast<unsigned char>(*p)))
+		v = v * 10 + (*p++ - '0');
+	if (p == digits || v == 0)
+		ok = false;
+	while (p < end && !isBlank(*p)) ++p;
+	out = neg ? -v : v;
+	return p;
+}
+
+static size_t countTokens(const char* p, const char* end) {
+	size_t n = 0;
+	for (p = skipBlank(p, end); p < end; p = skipBlank(p, end)) {
+		++n;
+		while (p < end && !isBlank(*p)) ++p;
+	}
+	return n;
+}
+
+// "v x y z" or "f a b c ...", p past the blanks of the line
+static char lineKind(const char* p, const char* eol) {
+	if (eol - p < 2 || !isBlank(p[1]))
+		return 0;
+	return (p[0] == 'v' || p[0] == 'f') ? p[0] : 0;
+}
+
+static void countChunk(ObjChunk &c) {
+	for (const char* line = c.begin; line < c.end; ) {
+		const char* eol = lineEnd(line, c.end);
+		const char* p = skipBlank(line, eol);
+		char kind = lineKind(p, eol);
+		if (kind == 'v')
+			++c.vertices;
+		else if (kind == 'f') {
+			size_t k = countTokens(p + 1, eol);
+			if (k >= 3) c.triangles += k - 2;
+		}
+		line = eol + 1;
+	}
+}
+
+// Same walk as countChunk: writes exactly what it counted. Faces are fanned
+// from their first vertex, indices stay unresolved past the vertex count
+static void parseChunk(ObjChunk &c, float* vertices, uint32_t* indices) {
+	size_t v = c.firstVertex;
+	size_t t = c.firstTriangle;
+	bool ok = true;
+	for (const char* line = c.begin; line < c.end; ) {
+		const char* eol = lineEnd(line, c.end);
+		const char* p = skipBlank(line, eol);
+		char kind = lineKind(p, eol);
+		if (kind == 'v') {
+			float* out = vertices + 3 * v++;
+			p = parseFloat(p + 1, eol, out[0], ok);
+			p = parseFloat(p, eol, out[1], ok);
+			p = parseFloat(p, eol, out[2], ok);
+			glm::vec3 pos(out[0], out[1], out[2]);
+			c.bmin = glm::min(c.bmin, pos);
+			c.bmax = glm::max(c.bmax, pos);
+		} else if (kind == 'f' && countTokens(p + 1, eol) >= 3) {
+			uint32_t first = 0, prev = 0;
+			size_t k = 0;
+			for (p = skipBlank(p + 1, eol); p < eol; p = skipBlank(p, eol), ++k) {
+				long index;
+				p = parseIndex(p, eol, index, ok);
+				long resolved = index > 0 ? index - 1 : static_cast<long>(v) + index;	// relative: to the vertices so far
+				uint32_t cur = resolved < 0 ? UINT32_MAX : static_cast<uint32_t>(resolved);
+				if (k == 0) first = cur;
+				else if (k >= 2) {
+					uint32_t* tri = indices + 3 * t++;
+					tri[0] = first;
+					tri[1] = prev;
+					tri[2] = cur;
+				}
+				prev = cur;
+			}
+		}
+		line = eol + 1;
+	}
+	c.bad = !ok;
+}
+
+// Column centers, off the cell centers so a ray never runs along a shared edge
+#define SPAN_JITTER_X	0.5003f
+#define SPAN_JITTER_Y	0.5007f
+
+static float columnCenter(int i, float jitter) {
+	return -1.0f + (static_cast<float>(i) + jitter) * (2.0f / MESH_COLUMNS);
+}
+
+// Columns whose center lies in [lo, hi]
+static void columnRange(float lo, float hi, float jitter, int &first, int &last) {
+	const float cells = MESH_COLUMNS / 2.0f;
+	first = std::max(0, static_cast<int>(std::ceil((lo + 1.0f) * cells - jitter)));
+	last = std::min(MESH_COLUMNS - 1, static_cast<int>(std::floor((hi + 1.0f) * cells - jitter)));
+}
+
+// Inside of the mesh by ray parity: a ray along z through every column center
+// crosses the surface an even number of times, each pair of crossings bounds an
+// inside span. Right for any closed mesh, star-shaped or not; an odd crossing
+// left by a hole is dropped. Rows of columns are independent tasks
+static void buildSpans(Mesh &mesh, size_t nTriangles) {
+	std::vector<std::vector<uint32_t>> rows(MESH_COLUMNS);		// triangles crossing each row, binned on this thread
+	for (size_t t = 0; t < nTriangles; ++t) {
+		const float* v = mesh.triangles.data() + 9 * t;
+		int first, last;
+		columnRange(std::min(v[1], std::min(v[4], v[7])), std::max(v[1], std::max(v[4], v[7])), SPAN_JITTER_Y, first, last);
+		for (int r = first; r <= last; ++r)
+			rows[r].push_back(static_cast<uint32_t>(t));
+	}
+
+	std::vector<std::vector<float>> rowSpans(MESH_COLUMNS);
+	parallelFor(MESH_COLUMNS, [&](size_t r) {
+		const float y = columnCenter(static_cast<int>(r), SPAN_JITTER_Y);
+		std::vector<std::vector<float>> hits(MESH_COLUMNS);
+		for (uint32_t t : rows[r]) {
+			const float* v = mesh.triangles.data() + 9 * t;
+			const glm::vec3 a(v[0], v[1], v[2]), b(v[3], v[4], v[5]), c(v[6], v[7], v[8]);
+			const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+			if (area == 0.0f)
+				continue;		// edge on, parallel to the rays
+			int first, last;
+			columnRange(std::min(a.x, std::min(b.x, c.x)), std::max(a.x, std::max(b.x, c.x)), SPAN_JITTER_X, first, last);
+			for (int col = first; col <= last; ++col) {
+				const float x = columnCenter(col, SPAN_JITTER_X);
+				// Barycentric weights from the edge functions, positive inside
+				float wa = (c.x - b.x) * (y - b.y) - (c.y - b.y) * (x - b.x);
+				float wb = (a.x - c.x) * (y - c.y) - (a.y - c.y) * (x - c.x);
+				float wc = (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+				if (area < 0.0f) {
+					wa = -wa; wb = -wb; wc = -wc;
+				}
+				if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+					continue;
+				hits[col].push_back((wa * a.z + wb * b.z + wc * c.z) / (wa + wb + wc));
+			}
+		}
+
+		const float y0 = -1.0f + static_cast<float>(r) * (2.0f / MESH_COLUMNS);
+		for (int col = 0; col < MESH_COLUMNS; ++col) {
+			std::vector<float> &z = hits[col];
+			std::sort(z.begin(), z.end());
+			const float x0 = -1.0f + static_cast<float>(col) * (2.0f / MESH_COLUMNS);
+			for (size_t k = 0; k + 1 < z.size(); k += 2) {
+				if (z[k + 1] <= z[k])
+					continue;
+				const float span[6] = {x0, y0, x0 + 2.0f / MESH_COLUMNS, y0 + 2.0f / MESH_COLUMNS, z[k], z[k + 1]};
+				rowSpans[r].insert(rowSpans[r].end(), span, span + 6);
+			}
+		}
+	});
+
+	// Same column area everywhere: the running length is the running volume
+	double length = 0.0;
+	for (const std::vector<float> &row : rowSpans) {
+		for (size_t k = 0; k < row.size(); k += 6) {
+			length += row[k + 5] - row[k + 4];
+			mesh.spanCdf.push_back(static_cast<float>(length));
+		}
+		mesh.spans.insert(mesh.spans.end(), row.begin(), row.end());
+	}
+	for (float &f : mesh.spanCdf)
+		f = static_cast<float>(f / length);
+}
+
+void readObj(const std::string &path, Mesh &mesh) {
+	MappedFile file;
+	file.open(path);
+	const char* data = reinterpret_cast<const char*>(file.data());
+	const char* end = data + file.size();
+
+	// Chunk boundaries pushed to the next line start
+	std::vector<ObjChunk> chunks;
+	for (const char* p = data; p < end; ) {
+		ObjChunk c;
+		c.begin = p;
+		c.end = (static_cast<size_t>(end - p) <= MESH_CHUNK) ? end : lineEnd(p + MESH_CHUNK, end);
+		if (c.end < end) ++c.end;
+		chunks.push_back(c);
+		p = c.end;
+	}
+
+	parallelFor(chunks.size(), [&](size_t i) { countChunk(chunks[i]); });
+	size_t nVertices = 0, nTriangles = 0;
+	for (ObjChunk &c : chunks) {
+		c.firstVertex = nVertices;
+		c.firstTriangle = nTriangles;
+		nVertices += c.vertices;
+		nTriangles += c.triangles;
+	}
+	if (!nTriangles || nVertices >= UINT32_MAX)
+		throw fileError("   \033[33m" + path + " has no usable triangle\033[0m");
+
+	std::vector<float> vertices(3 * nVertices);
+	std::vector<uint32_t> indices(3 * nTriangles);
+	parallelFor(chunks.size(), [&](size_t i) { parseChunk(chunks[i], vertices.data(), indices.data()); });
+
+	glm::vec3 bmin(INFINITY), bmax(-INFINITY);
+	for (const ObjChunk &c : chunks) {
+		if (c.bad)
+			throw fileError("   \033[33mMalformed vertex or face in " + path + "\033[0m");
+		bmin = glm::min(bmin, c.bmin);
+		bmax = glm::max(bmax, c.bmax);
+	}
+	const glm::vec3 center = (bmin + bmax) * 0.5f;
+	const float halfExtent = std::max(std::max(bmax.x - bmin.x, bmax.y - bmin.y), bmax.z - bmin.z) * 0.5f;
+	const float scale = halfExtent > 0.0f ? 1.0f / halfExtent : 1.0f;
+
+	// Gather the corners, normalized, and the area of every triangle
+	mesh.triangles.resize(9 * nTriangles);
+	mesh.surfaceCdf.resize(nTriangles);
+	const size_t block = 65536;
+	const size_t nBlocks = (nTriangles + block - 1) / block;
+	std::vector<double> areaSums(nBlocks);
+	std::atomic<bool> outOfRange(false);
+	parallelFor(nBlocks, [&](size_t b) {
+		double area = 0.0;
+		const size_t last = std::min(nTriangles, (b + 1) * block);
+		for (size_t t = b * block; t < last; ++t) {
+			glm::vec3 corner[3];
+			for (int k = 0; k < 3; ++k) {
+				uint32_t index = indices[3 * t + k];
+				if (index >= nVertices) {
+					outOfRange = true;
+					index = 0;
+				}
+				const float* v = vertices.data() + 3 * index;
+				corner[k] = (glm::vec3(v[0], v[1], v[2]) - center) * scale;
+				std::memcpy(mesh.triangles.data() + 9 * t + 3 * k, &corner[k], 3 * sizeof(float));
+			}
+			float a = 0.5f * glm::length(glm::cross(corner[1] - corner[0], corner[2] - corner[0]));
+			mesh.surfaceCdf[t] = a;
+			area += a;
+		}
+		areaSums[b] = area;
+	});
+	if (outOfRange)
+		throw fileError("   \033[33mFace index out of range in " + path + "\033[0m");
+
+	// Two level prefix sum: block offsets on this thread, the blocks in parallel
+	double areaTotal = 0.0;
+	for (size_t b = 0; b < nBlocks; ++b) {
+		std::swap(areaTotal, areaSums[b]);
+		areaTotal += areaSums[b];
+	}
+	if (areaTotal <= 0.0)
+		throw fileError("   \033[33m" + path + " has no surface\033[0m");
+	parallelFor(nBlocks, [&](size_t b) {
+		double area = areaSums[b];
+		const size_t last = std::min(nTriangles, (b + 1) * block);
+		for (size_t t = b * block; t < last; ++t) {
+			area += mesh.surfaceCdf[t];
+			mesh.surfaceCdf[t] = static_cast<float>(area / areaTotal);
+		}
+	});
+	buildSpans(mesh, nTriangles);
+	mesh.vertices = nVertices;
+}
+
+// Parsed on the host threads, the triangles and both tables uploaded once:
+// initShape only samples them
+void ParticleSystem::loadMesh(const std::string &path) {
+	if (_compute)
+		throw fileError("   \033[33mMesh shapes need the OpenCL backend\033[0m");
+	const auto start = std::chrono::steady_clock::now();
+	Mesh mesh;
+	readObj(path, mesh);
+
+	const size_t count = mesh.surfaceCdf.size();
+	const size_t nSpans = mesh.spanCdf.size();
+	ClMem triangles = _pool.buffer(CL_MEM_READ_ONLY, mesh.triangles.size() * sizeof(float));
+	ClMem surface = _pool.buffer(CL_MEM_READ_ONLY, count * sizeof(float));
+	ClMem spans, spanCdf;		// none for an open or flat mesh
+	cl_int err;
+	err  = clEnqueueWriteBuffer(_clQueue, triangles, CL_FALSE, 0, mesh.triangles.size() * sizeof(float),
+		mesh.triangles.data(), 0, nullptr, nullptr);
+	err |= clEnqueueWriteBuffer(_clQueue, surface, CL_FALSE, 0, count * sizeof(float), mesh.surfaceCdf.data(), 0, nullptr, nullptr);
+	if (nSpans) {
+		spans = _pool.buffer(CL_MEM_READ_ONLY, mesh.spans.size() * sizeof(float));
+		spanCdf = _pool.buffer(CL_MEM_READ_ONLY, nSpans * sizeof(float));
+		err |= clEnqueueWriteBuffer(_clQueue, spans, CL_FALSE, 0, mesh.spans.size() * sizeof(float), mesh.spans.data(), 0, nullptr, nullptr);
+		err |= clEnqueueWriteBuffer(_clQueue, spanCdf, CL_FALSE, 0, nSpans * sizeof(float), mesh.spanCdf.data(), 0, nullptr, nullptr);
+	}
+	clFinish(_clQueue);		// the host copies must outlive the writes
+	if (err != CL_SUCCESS) throw openClError("Failed to upload the mesh");
+
+	_pool.recycle(_meshTriangles);
+	_pool.recycle(_meshSurfaceCdf);
+	_pool.recycle(_meshSpans);
+	_pool.recycle(_meshSpanCdf);
+	_meshTriangles = std::move(triangles);
+	_meshSurfaceCdf = std::move(surface);
+	_meshSpans = std::move(spans);
+	_meshSpanCdf = std::move(spanCdf);
+	_meshTriangleCount = static_cast<cl_uint>(count);
+	_meshSpanCount = static_cast<cl_uint>(nSpans);
+	_meshPath = path;
+	_meshLoadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -6,19 +6,39 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/12/17 15:40:39 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/19 16:52:13 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 02:14:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "ParticleSystem.hpp"
+#include "Streaming.hpp"
+#include "Parallel.hpp"
+#include "Mesh.hpp"
+#include "Picture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 // Constructeur
-ParticleSystem::ParticleSystem(size_t num, const std::string& shape): _radius(5.0f), _nbParticle(num), _clContext(0) {
+ParticleSystem::ParticleSystem(size_t num, const std::string& shape, const std::string &device, const std::string &split,
+	const std::string &backend)
+	: _radius(5.0f), _nbParticle(num), _capacity(num) {
 	_shape = (shape == "sphere") ? 0 : 1;
+	selectBackend(device, split, backend);	// OpenCL (GL sharing or not) or GL compute
+	if (!_compute)
+		createArena();			// Gravity sources and kernel scratch
 	createBuffers();			// glGenBuffers && glBufferData
 	registerInterop();			// clCreateFromGLBuffer
+	createCullBuffers();		// Visible indices and indirect draw command
 	createKernel();				// GPU Kernel
-	initializeShape(shape);		// Call the first kernel
+	if (isObjPath(shape))
+		loadMesh(shape);		// Triangles and area table on the device, throws on GL compute
+	if (isPicturePath(shape)) {
+		loadPicture(shape);		// Pixels and luminance tables on the device, throws without image support
+		_colorMode = 3;
+	}
+	initializeShape(isObjPath(shape) ? "mesh" : (isPicturePath(shape) ? "image" : shape));		// Call the first kernel
 
 	_GravityCenter.clear();
 	_GravityCenter.push_back(GravityPoint(50.0f, 50.0f, 25.0f, 1.0f, 300.0f));
@@ -27,36 +47,229 @@ ParticleSystem::ParticleSystem(size_t num, const std::string& shape): _radius(5.
 }
 
 ParticleSystem::~ParticleSystem() {
-	if (_initShape) clReleaseKernel(_initShape);
-	if (_updateSys) clReleaseKernel(_updateSys);
-	// if (_clProgram) clReleaseProgram(_clProgram);
-	// if (_clPosBuffer) clReleaseMemObject(_clPosBuffer);
-	// if (_clVelBuffer) clReleaseMemObject(_clVelBuffer);
-	// if (_clColBuffer) clReleaseMemObject(_clColBuffer);
-	if (_clGravityBuffer) clReleaseMemObject(_clGravityBuffer);
-	// if (_clQueue) clReleaseCommandQueue(_clQueue);
-	// if (_clContext) clReleaseContext(_clContext);
+	// Handles release the rest; the pool goes before the program and the context
+	stopStreaming();
+	releaseBuffers();
+	if (_statsEvent) clReleaseEvent(_statsEvent);
+	for (Partition &p : _partitions)
+		p.gravity.reset();
+	_arena.release();
+	_noiseA.reset();
+	_noiseB.reset();
+	_fieldImage.reset();
+	_vfieldImage.reset();
+	_meshTriangles.reset();
+	_meshSurfaceCdf.reset();
+	_meshSpans.reset();
+	_meshSpanCdf.reset();
+	_picture.reset();
+	_pictureRows.reset();
+	_picturePixels.reset();
+	_pool.clear();
+	_clProgram.reset();
+	_clContext.reset();
+	for (cl_device_id sub : _subDevices)
+		clReleaseDevice(sub);
+	if (_vao) glDeleteVertexArrays(1, &_vao);
+}
+
+// GL compute when asked, or when OpenCL would have to copy every frame (no
+// context at all, or no GL sharing). A split always stays on OpenCL.
+void ParticleSystem::selectBackend(const std::string &device, const std::string &split, const std::string &backend) {
+	if (backend != "gl") {
+		try {
+			createContext(device, split);
+		} catch (openClError &e) {
+			if (backend == "cl" || !split.empty() || !glExt.compute)
+				throw;
+			std::cerr << e.what() << std::endl;
+			dropOpenCl();
+		}
+	}
+	const bool fallback = backend.empty() && split.empty() && !_interop && glExt.compute;
+	if (backend != "gl" && !fallback)
+		return;
+
+	// Built before OpenCL goes: a shader that does not compile leaves the copy path
+	std::unique_ptr<GlCompute> compute = std::make_unique<GlCompute>();
+	try {
+		compute->init();
+	} catch (openGlError &e) {
+		if (backend == "gl" || !_clContext.get())
+			throw;
+		std::cerr << e.what() << std::endl;
+		std::cerr << "Simulation: staying on OpenCL, buffers copied to OpenGL" << std::endl;
+		return;
+	}
+	dropOpenCl();
+	_compute = std::move(compute);
+	_device = ClDeviceInfo();
+	_device.platformName = "OpenGL";
+	_device.name = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	std::cout << "Simulation: OpenGL compute shaders on " << _device.name << std::endl;
+}
+
+// Whatever createContext got to, the GL compute backend runs without it
+void ParticleSystem::dropOpenCl() {
+	_pool.clear();
+	_clQueue = nullptr;
+	_clContext.reset();
+	for (cl_device_id sub : _subDevices)
+		clReleaseDevice(sub);
+	_subDevices.clear();
+	_contextDevices.clear();
+	_partitions.clear();
+	_interop = false;
+}
+
+// Persistent regions first, the scratch grows behind them
+void ParticleSystem::createArena() {
+	_arena.init(_pool, _clQueue, _contextDevices, ARENA_INITIAL);
+	_gravityRegion = _arena.persistent(sizeof(GravityPoint) * STATS_MAX_GP, CL_MEM_READ_ONLY);
+}
+
+// Pick the device, then try to share the GL buffers with it.
+// Without cl_khr_gl_sharing (or when the GL context lives on another GPU)
+// the kernels run on CL buffers of their own and releaseGLObjects copies the results.
+void ParticleSystem::createContext(const std::string &deviceName, const std::string &split) {
+	std::vector<ClDeviceInfo> devices = listClDevices();
+	_device = selectClDevice(devices, deviceName);
+	if (!split.empty()) {
+		createSplitContext(devices, split);
+		return;
+	}
+	_contextDevices.assign(1, _device.device);
+
+	cl_int err = CL_INVALID_OPERATION;
+	if (_device.glSharing) {
+		// Create context with OpenGL sharing
+		cl_context_properties properties[] = {
+			#ifdef __APPLE__
+					CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
+					(cl_context_properties)CGLGetShareGroup(CGLGetCurrentContext()),
+			#elif defined(_WIN32)
+					CL_GL_CONTEXT_KHR, (cl_context_properties)wglGetCurrentContext(),
+					CL_WGL_HDC_KHR, (cl_context_properties)wglGetCurrentDC(),
+					CL_CONTEXT_PLATFORM, (cl_context_properties)_device.platform,
+			#else // Linux
+					CL_GL_CONTEXT_KHR, (cl_context_properties)glXGetCurrentContext(),
+					CL_GLX_DISPLAY_KHR, (cl_context_properties)glXGetCurrentDisplay(),
+					CL_CONTEXT_PLATFORM, (cl_context_properties)_device.platform,
+			#endif
+					0
+		};
+		_clContext.reset(clCreateContext(properties, 1, &_device.device, nullptr, nullptr, &err));
+	}
+
+	_interop = (err == CL_SUCCESS);
+	if (!_interop) {
+		cl_context_properties properties[] = {
+			CL_CONTEXT_PLATFORM, (cl_context_properties)_device.platform, 0
+		};
+		_clContext.reset(clCreateContext(properties, 1, &_device.device, nullptr, nullptr, &err));
+		if (err != CL_SUCCESS) throw openClError("Failed to create OpenCL context");
+	}
+
+	// Create the command queue: all OpenCL operations must be submitted here
+	// clQueue is a mailman: aquires buffer, launches kernel and releases GL buffers
+	_pool.setContext(_clContext);
+	_clQueue = _pool.queue(_device.device);
+
+	std::cout << "OpenCL device: " << _device.label()
+			  << (_interop ? " (GL sharing)" : " (copy path)") << std::endl;
+}
+
+// Split mode: one context over several devices of a platform ("name,name"),
+// or over the NUMA nodes of one CPU device ("numa"). Each partition gets its queue,
+// GL sharing is never tried: the slices are gathered by the copy path.
+void ParticleSystem::createSplitContext(const std::vector<ClDeviceInfo> &devices, const std::string &split) {
+	if (split == "numa") {
+		_subDevices = createNumaSubDevices(_device.device);
+		if (_subDevices.empty())
+			throw openClError("   \033[33m" + _device.label() + " can't be split by NUMA node\033[0m");
+		for (size_t i = 0; i < _subDevices.size(); ++i) {
+			Partition p;
+			p.label  = _device.name + " / node " + std::to_string(i);
+			p.device = _subDevices[i];
+			clGetDeviceInfo(p.device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(p.weight), &p.weight, nullptr);
+			_partitions.push_back(std::move(p));
+		}
+	} else {
+		std::vector<ClDeviceInfo> selected = selectClDevices(devices, split);
+		_device = selected.front();
+		for (const ClDeviceInfo &info : selected) {
+			Partition p;
+			p.label  = info.label();
+			p.device = info.device;
+			p.weight = info.computeUnits;
+			_partitions.push_back(std::move(p));
+		}
+	}
+	for (const Partition &p : _partitions)
+		_contextDevices.push_back(p.device);
+
+	cl_int err;
+	cl_context_properties properties[] = {
+		CL_CONTEXT_PLATFORM, (cl_context_properties)_device.platform, 0
+	};
+	_clContext.reset(clCreateContext(properties, static_cast<cl_uint>(_contextDevices.size()), _contextDevices.data(),
+		nullptr, nullptr, &err));
+	if (err != CL_SUCCESS) throw openClError("Failed to create OpenCL context");
+	_interop = false;
+
+	// Main queue (initShape, stats, snapshots, gather) on the first partition's device
+	_pool.setContext(_clContext);
+	_clQueue = _pool.queue(_contextDevices.front());
+	for (Partition &p : _partitions)
+		p.queue = _pool.queue(p.device, "partition");
+
+	std::cout << "OpenCL split over " << _partitions.size() << " partitions:" << std::endl;
+	for (const Partition &p : _partitions)
+		std::cout << "   " << p.label << " (" << p.weight << " compute units)" << std::endl;
 }
 
 void ParticleSystem::createBuffers() {
 	// Number of particles, each particle stores 4 float, a vect4(x, y, z, w)
-	const std::size_t bufferSize = _nbParticle * sizeof(float) * 4;
+	const std::size_t bufferSize = _capacity * sizeof(float) * 4;
 
-	glGenBuffers(1, &_posBuffer); 				// 1 is for the number of buffer object
+	// Copy path: positions and colors are written by the host every frame,
+	// through a mapping kept for the whole life of the buffer, HOST_RING slots
+	const bool persistent = !_interop && !_compute && glExt.bufferStorage;
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const std::size_t ringSize = bufferSize * HOST_RING;
+	_hostSlot = 0;
+
+	_posBuffer.create(persistent ? ringSize : bufferSize); 	// glGenBuffers, deleted with the handle
 	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);	// Vertex attributes
-	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
+	if (persistent) {
+		glBufferStorage(GL_ARRAY_BUFFER, ringSize, nullptr, flags);
+		_posMapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, ringSize, flags));
+	} else
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
 	// nullptr is the proof that no CPU memory is used here
 	// GL_DYNAMIC_DRAW because, it's updated every frame: OpenGl drivers treats this as "frequently modified"
 
-	glGenBuffers(1, &_velBuffer);
+	_velBuffer.create(bufferSize);
 	glBindBuffer(GL_ARRAY_BUFFER, _velBuffer);
 	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
 
-	glGenBuffers(1, &_colorBuffer);
+	// Only ever written by GL itself, see keepPrevious
+	_prevBuffer.create(bufferSize);
+	glBindBuffer(GL_ARRAY_BUFFER, _prevBuffer);
+	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_COPY);
+	_prevValid = false;
+
+	_colorBuffer.create(persistent ? ringSize : bufferSize);
 	glBindBuffer(GL_ARRAY_BUFFER, _colorBuffer);
-	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
+	if (persistent) {
+		glBufferStorage(GL_ARRAY_BUFFER, ringSize, nullptr, flags);
+		_colMapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, ringSize, flags));
+	} else
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (persistent && (!_posMapped || !_colMapped))
+		throw openGlError("   \033[33mFailed to map the particle buffers\033[0m");
 }
 
 // The GPU buffers becomes visible to OpenCL for computation
@@ -64,56 +277,35 @@ void ParticleSystem::createBuffers() {
 // Acquire and release buffer
 // Avoid CPU-side copies
 void ParticleSystem::registerInterop() {
-	// Create the context in which OpenCl will evolve
-	cl_platform_id platform;
-	clGetPlatformIDs(1, &platform, nullptr);
-
-	// Which GPU
-	cl_device_id device;
-	clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr);
-
-	// Create context with OpenGL sharing
-	cl_context_properties properties[] = {
-		#ifdef __APPLE__
-				CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
-				(cl_context_properties)CGLGetShareGroup(CGLGetCurrentContext()),
-		#elif defined(_WIN32)
-				CL_GL_CONTEXT_KHR, (cl_context_properties)wglGetCurrentContext(),
-				CL_WGL_HDC_KHR, (cl_context_properties)wglGetCurrentDC(),
-				CL_CONTEXT_PLATFORM, (cl_context_properties)platform,
-		#else // Linux
-				CL_GL_CONTEXT_KHR, (cl_context_properties)glXGetCurrentContext(),
-				CL_GLX_DISPLAY_KHR, (cl_context_properties)glXGetCurrentDisplay(),
-				CL_CONTEXT_PLATFORM, (cl_context_properties)platform,
-		#endif
-				0
-	};
-	
 	cl_int err;
-	if (!_clContext) {
-		_clContext = clCreateContext(properties, 1, &device, nullptr, nullptr, &err);
-		if (err != CL_SUCCESS) throw openClError("Failed to create OpenCL context with GL sharing");
+	const std::size_t bufferSize = _capacity * sizeof(float) * 4;
+
+	if (_compute)
+		return;			// the compute shaders write the GL buffers themselves
+	if (!_interop) {
+		// No sharing: same buffers on the device side, copied to GL by releaseGLObjects
+		_clPosBuffer = _pool.buffer(CL_MEM_READ_WRITE, bufferSize);
+		_clVelBuffer = _pool.buffer(CL_MEM_READ_WRITE, bufferSize);
+		_clColBuffer = _pool.buffer(CL_MEM_READ_WRITE, bufferSize);
+		createPartitionBuffers();
+		return;
 	}
 
-	
 	// Create OpenCl memory object from GL Buffers
 	// This makes VRAM buffers visible to OpenCL
-	_clPosBuffer = clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _posBuffer, &err);
+	_clPosBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _posBuffer, &err));
 	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to create position buffer\033[0m");
 	
-	_clVelBuffer = clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _velBuffer, &err);
+	_clVelBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _velBuffer, &err));
 	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to create velocity buffer\033[0m");
 
-	_clColBuffer = clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _colorBuffer, &err);
+	_clColBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _colorBuffer, &err));
 	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to create color buffer\033[0m");
-
-	// Create the command queue: all OpenCL operations must be submitted here
-	// clQueue is a mailman: aquires buffer, launches kernel and releases GL buffers
-	_clQueue = clCreateCommandQueue(_clContext, device, 0, &err);
-	if (err != CL_SUCCESS) throw openClError("Failed to create OpenCL command queue");
 }
 
 void ParticleSystem::createKernel() {
+	if (_compute)
+		return;
 	// Take the .cl file
 	std::ifstream file("./srcs/kernels.cl");
 	if (!file.is_open())
@@ -125,14 +317,22 @@ void ParticleSystem::createKernel() {
 
 	// Create and build the cl_program
 	cl_int err;
-	_clProgram = clCreateProgramWithSource(_clContext, 1, &src_cstr, nullptr, &err);
+	_clProgram.reset(clCreateProgramWithSource(_clContext, 1, &src_cstr, nullptr, &err));
 	if (err != CL_SUCCESS)
 		throw openClError("   \033[33mFailed to create cl program\033[0m");
 
-	cl_device_id device;
-	clGetContextInfo(_clContext, CL_CONTEXT_DEVICES, sizeof(device), &device, nullptr);
+	cl_device_id device = _contextDevices.front();
+
+	// The noise volumes and the force fields are images: every device of the context must read them
+	cl_bool images = CL_TRUE;
+	for (cl_device_id d : _contextDevices) {
+		cl_bool support = CL_FALSE;
+		clGetDeviceInfo(d, CL_DEVICE_IMAGE_SUPPORT, sizeof(support), &support, nullptr);
+		images = images && support;
+	}
 
-	err = clBuildProgram(_clProgram, 1, &device, nullptr, nullptr, nullptr);
+	err = clBuildProgram(_clProgram, static_cast<cl_uint>(_contextDevices.size()), _contextDevices.data(),
+		images ? "-D NOISE_VOLUME -D FORCE_FIELD -D VECTOR_FIELD -D IMAGE_SHAPE" : nullptr, nullptr, nullptr);
 	if (err != CL_SUCCESS) {
 	// Get build log
 		size_t log_size;
@@ -143,16 +343,214 @@ void ParticleSystem::createKernel() {
 		
 		throw openClError("   \033[33mFailed to build OpenCL program\033[0m");
 	}
+
+	// Statistics pass: fixed size output, whatever the particle count
+	_pool.setProgram(_clProgram);
+	_reduceStats = _pool.kernel("reduceStats");
+	_statsPartials.resize(STATS_GROUPS);
+	_cullFrustum = _pool.kernel("cullFrustum");
+	_sortKeys = _pool.kernel("sortKeys");
+	_radixHistogram = _pool.kernel("radixHistogram");
+	_radixScan = _pool.kernel("radixScan");
+	_radixScatter = _pool.kernel("radixScatter");
+	_recordTrails = _pool.kernel("recordTrails");
+	_fieldImages = images;
+	if (images) {
+		bakeNoise();
+		// initShape always takes an image: one white texel until a picture is loaded
+		const unsigned char white[4] = {255, 255, 255, 255};
+		cl_image_format format = {CL_RGBA, CL_UNORM_INT8};
+		cl_image_desc desc = {};
+		desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+		desc.image_width = desc.image_height = 1;
+		_picture.reset(clCreateImage(_clContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, &format, &desc,
+			const_cast<unsigned char*>(white), &err));
+		if (err != CL_SUCCESS)
+			throw openClError("   \033[33mFailed to create the picture placeholder\033[0m");
+	}
+}
+
+// Two volumes of different seeds, baked once: blending between them and scrolling
+// animate the field, nothing is evaluated per particle but two filtered fetches
+void ParticleSystem::bakeNoise() {
+	cl_kernel bake = _pool.kernel("bakeCurlNoise");
+	const cl_uint size = NOISE_SIZE;
+	const size_t texels = static_cast<size_t>(size) * size * size;
+	ClMem field = _pool.buffer(CL_MEM_READ_WRITE, texels * sizeof(cl_float4));
+
+	cl_image_format format = {CL_RGBA, CL_FLOAT};
+	cl_image_desc desc = {};
+	desc.image_type = CL_MEM_OBJECT_IMAGE3D;
+	desc.image_width = desc.image_height = desc.image_depth = size;
+	const size_t origin[3] = {0, 0, 0};
+	const size_t region[3] = {size, size, size};
+
+	ClMem* volumes[] = {&_noiseA, &_noiseB};
+	cl_int err;
+	for (cl_uint i = 0; i < 2; ++i) {
+		volumes[i]->reset(clCreateImage(_clContext, CL_MEM_READ_ONLY, &format, &desc, nullptr, &err));
+		if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to create the noise volume\033[0m");
+
+		cl_uint seed = 0x9e3779b9u * (i + 1);
+		err  = clSetKernelArg(bake, 0, sizeof(cl_mem), field.addr());
+		err |= clSetKernelArg(bake, 1, sizeof(cl_uint), &size);
+		err |= clSetKernelArg(bake, 2, sizeof(cl_uint), &seed);
+		size_t local = 128;
+		size_t global = ((texels + local - 1) / local) * local;
+		err |= clEnqueueNDRangeKernel(_clQueue, bake, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+		err |= clEnqueueCopyBufferToImage(_clQueue, field, *volumes[i], 0, origin, region, 0, nullptr, nullptr);
+		if (err != CL_SUCCESS) throw openClError("Failed to bake the noise volume");
+	}
+	clFinish(_clQueue);
+	_pool.recycle(field);
+}
+
+// Blend weight and scroll follow the simulated time, streaming passes included
+cl_int ParticleSystem::setVolumeArgs(float time) {
+	if (!_noiseA.get())
+		return CL_SUCCESS;		// program built without the volumes
+	float blend = 0.5f - 0.5f * std::cos(time * NOISE_BLEND_RATE);
+	float scroll = time * NOISE_SCROLL;
+	scroll -= std::floor(scroll);	// repeat addressing, keeps the coordinates small
+	cl_int baked = _bakedNoise ? 1 : 0;
+
+	cl_int err;
+	err  = clSetKernelArg(_updateSys, 10, sizeof(cl_mem), _noiseA.addr());
+	err |= clSetKernelArg(_updateSys, 11, sizeof(cl_mem), _noiseB.addr());
+	err |= clSetKernelArg(_updateSys, 12, sizeof(float), &blend);
+	err |= clSetKernelArg(_updateSys, 13, sizeof(float), &scroll);
+	err |= clSetKernelArg(_updateSys, 14, sizeof(cl_int), &baked);
+
+	// Texel i at _fieldMin + i * cell, its center at (i + 0.5) / FIELD_SIZE.
+	// Not baked yet: any image fills the argument, the kernel doesn't read it
+	const glm::vec3 cell = (_fieldMax - _fieldMin) / static_cast<float>(FIELD_SIZE - 1);
+	const glm::vec4 scale(1.0f / (glm::max(cell, glm::vec3(1e-6f)) * static_cast<float>(FIELD_SIZE)), 0.0f);
+	const glm::vec4 offset(0.5f / FIELD_SIZE - _fieldMin * glm::vec3(scale), 0.0f);
+	cl_int field = fieldLive() ? 1 : 0;
+	err |= clSetKernelArg(_updateSys, 15, sizeof(cl_mem), _fieldImage.get() ? _fieldImage.addr() : _noiseA.addr());
+	err |= clSetKernelArg(_updateSys, 16, sizeof(cl_float4), glm::value_ptr(scale));
+	err |= clSetKernelArg(_updateSys, 17, sizeof(cl_float4), glm::value_ptr(offset));
+	err |= clSetKernelArg(_updateSys, 18, sizeof(cl_int), &field);
+
+	// Imported field: source relative position to normalized coordinates
+	const glm::vec3 vmin = _vfieldMin * _vfieldScale;
+	const glm::vec3 vsize = glm::max((_vfieldMax - _vfieldMin) * _vfieldScale, glm::vec3(1e-6f));
+	const glm::vec4 vfieldMin(vmin, 0.0f);
+	const glm::vec4 vfieldInvSize(1.0f / vsize, 0.0f);
+	cl_int vfield = hasVectorField() ? 1 : 0;
+	err |= clSetKernelArg(_updateSys, 19, sizeof(cl_mem), hasVectorField() ? _vfieldImage.addr() : _noiseA.addr());
+	err |= clSetKernelArg(_updateSys, 20, sizeof(cl_float4), glm::value_ptr(vfieldMin));
+	err |= clSetKernelArg(_updateSys, 21, sizeof(cl_float4), glm::value_ptr(vfieldInvSize));
+	err |= clSetKernelArg(_updateSys, 22, sizeof(float), &_vfieldFalloff);
+	err |= clSetKernelArg(_updateSys, 23, sizeof(cl_int), &vfield);
+	return err;
+}
+
+// Rebaked when the sources changed, when the cloud leaves the box or when the box
+// has become much larger than the cloud: the resolution follows the particles
+void ParticleSystem::refreshField() {
+	if (!_forceField || !_fieldImages || !_stats.valid)
+		return;
+	const glm::vec3 extent = glm::max(_stats.bmax - _stats.bmin, glm::vec3(1.0f));
+	const glm::vec3 padded = extent * (1.0f + 2.0f * FIELD_MARGIN);
+	const bool inside = glm::all(glm::greaterThanEqual(_stats.bmin, _fieldMin))
+		&& glm::all(glm::lessThanEqual(_stats.bmax, _fieldMax));
+	const bool loose = glm::any(glm::greaterThan(_fieldMax - _fieldMin, padded * 2.0f));
+	if (_fieldStale || !_fieldImage.get() || !inside || loose)
+		bakeField(_stats.bmin - extent * FIELD_MARGIN, _stats.bmax + extent * FIELD_MARGIN);
+}
+
+// One texel per work-item, then the interpolation error measured at the cell
+// centers: a blocking read, but only when the field changes
+void ParticleSystem::bakeField(const glm::vec3 &bmin, const glm::vec3 &bmax) {
+	cl_kernel bake = _pool.kernel("bakeForceField");
+	cl_kernel check = _pool.kernel("fieldError");
+	const size_t texels = static_cast<size_t>(FIELD_SIZE) * FIELD_SIZE * FIELD_SIZE;
+	const size_t cells = static_cast<size_t>(FIELD_SIZE - 1) * (FIELD_SIZE - 1) * (FIELD_SIZE - 1);
+	const cl_uint nSources = static_cast<cl_uint>(std::min<size_t>(_GravityCenter.size(), STATS_MAX_GP));
+	const glm::vec4 boxMin(bmin, 0.0f);
+	const glm::vec4 cell((bmax - bmin) / static_cast<float>(FIELD_SIZE - 1), 0.0f);
+	cl_int err;
+
+	if (!_fieldImage.get()) {
+		cl_image_format format = {CL_RGBA, CL_FLOAT};
+		cl_image_desc desc = {};
+		desc.image_type = CL_MEM_OBJECT_IMAGE3D;
+		desc.image_width = desc.image_height = desc.image_depth = FIELD_SIZE;
+		_fieldImage.reset(clCreateImage(_clContext, CL_MEM_READ_ONLY, &format, &desc, nullptr, &err));
+		if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to create the force field\033[0m");
+	}
+
+	ClMem field = _pool.buffer(CL_MEM_READ_WRITE, texels * sizeof(cl_float4));
+	ClMem errors = _pool.buffer(CL_MEM_WRITE_ONLY, cells * sizeof(float));
+	const size_t origin[3] = {0, 0, 0};
+	const size_t region[3] = {FIELD_SIZE, FIELD_SIZE, FIELD_SIZE};
+	size_t local = 128;
+	size_t global = ((texels + local - 1) / local) * local;
+
+	err  = clSetKernelArg(bake, 0, sizeof(cl_mem), field.addr());
+	err |= clSetKernelArg(bake, 1, sizeof(cl_float4), glm::value_ptr(boxMin));
+	err |= clSetKernelArg(bake, 2, sizeof(cl_float4), glm::value_ptr(cell));
+	err |= clSetKernelArg(bake, 3, sizeof(cl_mem), _arena.addr(_gravityRegion));
+	err |= clSetKernelArg(bake, 4, sizeof(cl_uint), &nSources);
+	err |= clEnqueueNDRangeKernel(_clQueue, bake, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	err |= clEnqueueCopyBufferToImage(_clQueue, field, _fieldImage, 0, origin, region, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to bake the force field");
+
+	global = ((cells + local - 1) / local) * local;
+	err  = clSetKernelArg(check, 0, sizeof(cl_mem), _fieldImage.addr());
+	err |= clSetKernelArg(check, 1, sizeof(cl_float4), glm::value_ptr(boxMin));
+	err |= clSetKernelArg(check, 2, sizeof(cl_float4), glm::value_ptr(cell));
+	err |= clSetKernelArg(check, 3, sizeof(cl_mem), _arena.addr(_gravityRegion));
+	err |= clSetKernelArg(check, 4, sizeof(cl_uint), &nSources);
+	err |= clSetKernelArg(check, 5, sizeof(cl_mem), errors.addr());
+	err |= clEnqueueNDRangeKernel(_clQueue, check, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	std::vector<float> measured(cells);
+	err |= clEnqueueReadBuffer(_clQueue, errors, CL_TRUE, 0, cells * sizeof(float), measured.data(), 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to measure the force field error");
+	_pool.recycle(field);
+	_pool.recycle(errors);
+
+	float maxError = 0.0f;
+	double sum = 0.0;
+	size_t counted = 0;
+	for (float e : measured) {
+		if (e < 0.0f) continue;		// next to a source
+		maxError = std::max(maxError, e);
+		sum += e;
+		++counted;
+	}
+	_fieldMaxError = maxError;
+	_fieldMeanError = counted ? static_cast<float>(sum / counted) : 0.0f;
+	_fieldMin = bmin;
+	_fieldMax = bmax;
+	_fieldSources = _GravityCenter;
+	_fieldStale = false;
+	++_fieldBakes;
+}
+
+int ParticleSystem::shapeFlag(const std::string &shape) const {
+	if (shape == "mesh" || shape == "volume")		// open mesh: no inside, its surface
+		return hasMesh() && !_compute ? (shape == "volume" && _meshSpanCount ? 4 : 3) : 0;
+	if (shape == "image" || shape == "relief")
+		return hasPicture() && !_compute ? (shape == "image" ? 5 : 6) : 0;
+	return (shape == "sphere" ? 0 : (shape == "cube" ? 1 : 2));
+}
+
+const char* ParticleSystem::shapeName(int flag) {
+	const char* names[] = {"sphere", "cube", "pyramid", "mesh", "volume", "image", "relief"};
+	return names[std::max(0, std::min(flag, 6))];
 }
 
 void ParticleSystem::setKernel(const std::string &shape) {
 	cl_int err;
-	int flag = (shape == "sphere" ? 0 : (shape == "cube" ? 1 : 2));
+	int flag = shapeFlag(shape);
+	_shape = flag;
 
 	// Buffer arguments
-	err  = clSetKernelArg(_initShape, 0, sizeof(cl_mem), &_clPosBuffer);
-	err |= clSetKernelArg(_initShape, 1, sizeof(cl_mem), &_clVelBuffer);
-	err |= clSetKernelArg(_initShape, 2, sizeof(cl_mem), &_clColBuffer);
+	err  = clSetKernelArg(_initShape, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_initShape, 1, sizeof(cl_mem), _clVelBuffer.addr());
+	err |= clSetKernelArg(_initShape, 2, sizeof(cl_mem), _clColBuffer.addr());
 	
 	// Other data
 	cl_uint nb = static_cast<cl_uint>(_nbParticle); // On evite de passer un size_t* a OpenCl, il ne connait pas
@@ -161,9 +559,27 @@ void ParticleSystem::setKernel(const std::string &shape) {
 	err |= clSetKernelArg(_initShape, 5, sizeof(int), &flag);
 	
 	int nGravityPoints = static_cast<int>(_GravityCenter.size());
-	err |= clSetKernelArg(_initShape, 6, sizeof(cl_mem), &_clGravityBuffer);
+	err |= clSetKernelArg(_initShape, 6, sizeof(cl_mem), _arena.addr(_gravityRegion));
 	err |= clSetKernelArg(_initShape, 7, sizeof(cl_uint), &nGravityPoints);
 	err |= clSetKernelArg(_initShape, 8, sizeof(cl_uint), &_speed);
+	err |= clSetKernelArg(_initShape, 9, sizeof(cl_uint), &_seed);
+	cl_uint first = 0;
+	err |= clSetKernelArg(_initShape, 10, sizeof(cl_uint), &first);
+
+	// Null buffers without a mesh, the other shapes never read them
+	// the volume reads the inside spans in place of the triangles
+	err |= clSetKernelArg(_initShape, 11, sizeof(cl_mem), flag == 4 ? _meshSpans.addr() : _meshTriangles.addr());
+	err |= clSetKernelArg(_initShape, 12, sizeof(cl_mem), flag == 4 ? _meshSpanCdf.addr() : _meshSurfaceCdf.addr());
+	err |= clSetKernelArg(_initShape, 13, sizeof(cl_uint), flag == 4 ? &_meshSpanCount : &_meshTriangleCount);
+
+	// Program built with IMAGE_SHAPE only, the placeholder stands in for the picture
+	if (_fieldImages) {
+		err |= clSetKernelArg(_initShape, 14, sizeof(cl_mem), _picture.addr());
+		err |= clSetKernelArg(_initShape, 15, sizeof(cl_mem), _pictureRows.addr());
+		err |= clSetKernelArg(_initShape, 16, sizeof(cl_mem), _picturePixels.addr());
+		err |= clSetKernelArg(_initShape, 17, sizeof(cl_uint), &_pictureWidth);
+		err |= clSetKernelArg(_initShape, 18, sizeof(cl_uint), &_pictureHeight);
+	}
 	if (err != CL_SUCCESS)
 		throw openClError("   \033[33mFailed to set kernel init arguments\033[0m");
 }
@@ -172,95 +588,736 @@ void ParticleSystem::setKernel(const std::string &shape) {
 // Launches an OpenCl kernel tha writes directly into OpenGl buffers
 // Release the buffers back to OpenGl
 void ParticleSystem::initializeShape(const std::string& shape) {
+	if (_compute) {
+		_shape = shapeFlag(shape);
+		initializeRange(0);
+		return;
+	}
+
 	// 1 Aquiring OpenGl buffers
-	cl_int err;
-	cl_mem buffer[] = {_clPosBuffer, _clVelBuffer, _clColBuffer};
-	err = clEnqueueAcquireGLObjects(_clQueue, 3, buffer, 0, nullptr, nullptr);
-	if (err != CL_SUCCESS)
-		throw openClError("    \033[33mCan't aquire GL Objects\0330m");
+	acquireGLObjects();
 
 	// 2 Set kernel arguments
-	_initShape = clCreateKernel(_clProgram, "initShape", &err);
-	if (err != CL_SUCCESS)
-		throw openClError("    \033[33mFailed to create kernel _initShape\033[0m");
+	// Created once, the pool hands back the same kernels on every call
+	_initShape = _pool.kernel("initShape");
 	
 	setKernel(shape);
 
-	_updateSys = clCreateKernel(_clProgram, "updateSpace", &err);
-	if (err != CL_SUCCESS)
-		throw openClError("    \033[33mFailed to create kernel\033[0m");
+	_updateSys = _pool.kernel("updateSpace");
 
 	// 3 Launch kernel
 	size_t local = 128;
 	size_t global = ((static_cast<size_t>(_nbParticle) + local - 1) / local) * local;
-	clEnqueueNDRangeKernel(_clQueue, _initShape, 1,
+	cl_int err = clEnqueueNDRangeKernel(_clQueue, _initShape, 1,
 		nullptr, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel initShape");
 	
 	// 4 Release buffers back to OpenGl
-	clEnqueueReleaseGLObjects(_clQueue, 3, buffer, 0, nullptr, nullptr);
+	releaseGLObjects();
 
 	// 5. Ensure completion before rendering
 	clFinish(_clQueue);
+	migratePartitions();
+	_trailStride = 0;			// the particles jumped, trails start over
+	_prevValid = false;
 }
 
 void ParticleSystem::setupRendering() {
-	// Create VAO
+	// Create VAO, the previous one pointed to the old buffers
+	if (_vao) glDeleteVertexArrays(1, &_vao);
 	glGenVertexArrays(1, &_vao);
 	glBindVertexArray(_vao);
 	
-	// Bind position buffer
+	// Bind position buffer, at the current slot on the host written path
+	const void* offset = reinterpret_cast<const void*>(slotOffset(_hostSlot));
 	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, offset);
 	glEnableVertexAttribArray(0);
 	
 	// Bind color buffer
 	glBindBuffer(GL_ARRAY_BUFFER, _colorBuffer);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, offset);
 	glEnableVertexAttribArray(1);
+
+	// Positions before the last step, blended with the current ones
+	glBindBuffer(GL_ARRAY_BUFFER, _prevBuffer);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glEnableVertexAttribArray(2);
+
+	// Visible indices of the culled draw, part of the VAO state
+	if (_indexBuffer)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
 	
 	glBindVertexArray(0);
 }
 
-void ParticleSystem::render() {
+// Streaming: the decimated subset may not fill the buffers
+GLsizei ParticleSystem::drawCount() const {
+	return _stream ? static_cast<GLsizei>(_stream->nRendered) : static_cast<GLsizei>(_nbParticle);
+}
+
+void ParticleSystem::render(bool additive) {
+	// Level of detail: what the bigger points can't compensate is blended
+	if (additive) {
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	} else if (isTranslucent()) {
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);		// sorted, or nearly: nothing must hide what is behind
+	}
 	glBindVertexArray(_vao);
-	glDrawArrays(GL_POINTS, 0, _nbParticle);
+	if (_culled) {
+		// Count written by cullFrustum, never read back on the host
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+		glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		_culled = false;
+	} else
+		glDrawArrays(GL_POINTS, 0, drawCount());
 	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+
+	// The host must not overwrite this slot while the draw still reads it
+	fenceHostSlot();
+}
+
+// count, instances, first index, base vertex, base instance
+static const cl_uint cullReset[5] = {0, 1, 0, 0, 0};
+
+// Index list sized for the capacity, the command for a single draw.
+// Only with GL sharing: on the copy path the draw count would have to come back to the host
+void ParticleSystem::createCullBuffers() {
+	_sortedCount = 0;
+	_clIndexBuffer.reset();
+	_clIndirectBuffer.reset();
+	_indexBuffer.reset();
+	_indirectBuffer.reset();
+	if (!_interop || !glExt.drawIndirect)
+		return;
+
+	const size_t indexSize = _capacity * sizeof(GLuint);
+	_indexBuffer.create(indexSize);
+	glBindBuffer(GL_ARRAY_BUFFER, _indexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, indexSize, nullptr, GL_DYNAMIC_DRAW);
+	_indirectBuffer.create(sizeof(cullReset));
+	glBindBuffer(GL_ARRAY_BUFFER, _indirectBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cullReset), cullReset, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glFinish();
+
+	cl_int err;
+	_clIndexBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _indexBuffer, &err));	// sorted in place
+	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to share the culling index buffer\033[0m");
+	_clIndirectBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_READ_WRITE, _indirectBuffer, &err));
+	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to share the indirect draw buffer\033[0m");
+}
+
+// Fraction of the particles to draw, then the point size and alpha keeping
+// the covered area: size^2 * alpha * fraction stays the base size^2
+void ParticleSystem::updateLod(const glm::mat4 &mvp, int width, int height, float frameTime) {
+	const float count = static_cast<float>(drawCount());
+	float fraction = 1.0f;
+
+	if (!canCull() || count <= 0.0f)
+		_lodMode = 0;
+	if (_lodMode == 1 && _stats.valid) {
+		// Screen rectangle of the bounding box, the whole viewport if it crosses the camera plane
+		glm::vec2 lo(1.0f), hi(-1.0f);
+		bool behind = false;
+		for (int c = 0; c < 8; ++c) {
+			glm::vec3 corner((c & 1) ? _stats.bmax.x : _stats.bmin.x,
+				(c & 2) ? _stats.bmax.y : _stats.bmin.y, (c & 4) ? _stats.bmax.z : _stats.bmin.z);
+			glm::vec4 clip = mvp * glm::vec4(corner, 1.0f);
+			if (clip.w <= 0.0f) { behind = true; break; }
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			lo = glm::min(lo, ndc);
+			hi = glm::max(hi, ndc);
+		}
+		if (behind) { lo = glm::vec2(-1.0f); hi = glm::vec2(1.0f); }
+		lo = glm::clamp(lo, -1.0f, 1.0f);
+		hi = glm::clamp(hi, -1.0f, 1.0f);
+		float pixels = std::max(0.0f, hi.x - lo.x) * std::max(0.0f, hi.y - lo.y) * width * height / 4.0f;
+		fraction = _lodDensity * pixels / count;
+	} else if (_lodMode == 2) {
+		// Multiplicative controller, slow to come back so that vsync doesn't make it oscillate
+		float ms = frameTime * 1000.0f;
+		fraction = _lodFraction;
+		if (ms > _lodTargetMs * 1.05f)
+			fraction *= std::max(0.8f, _lodTargetMs / ms);
+		else
+			fraction *= 1.02f;
+	}
+	_lodFraction = (_lodMode == 0) ? 1.0f : glm::clamp(fraction, LOD_MIN_FRACTION, 1.0f);
+
+	// Whole pixels: fractional point sizes round anyway
+	_pointSize = std::min(LOD_MAX_POINT, std::ceil(_basePointSize / std::sqrt(_lodFraction)));
+	_pointAlpha = std::min(1.0f, _basePointSize * _basePointSize / (_lodFraction * _pointSize * _pointSize));
+}
+
+// Planes from the MVP rows (Gribb-Hartmann), in the space of the positions:
+// exactly what the vertex shader clips, points are clipped on their center
+void ParticleSystem::cull(const glm::mat4 &mvp) {
+	_culled = false;
+	cl_uint nb = static_cast<cl_uint>(drawCount());
+	const bool sorting = _sortMode != 0 && isTranslucent();
+	if ((!_cullEnabled && _lodFraction >= 1.0f && !sorting) || !canCull() || nb == 0)
+		return;
+
+	// Approximate: the previous order, and culling, are kept for a few frames
+	if (sorting && _sortMode == 2 && nb == _sortedCount && ++_sortFrame % SORT_APPROX_FRAMES != 0) {
+		_culled = true;
+		return;
+	}
+
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i)
+		row[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);	// glm is column major
+	glm::vec4 planes[6] = {
+		row[3] + row[0], row[3] - row[0],		// left, right
+		row[3] + row[1], row[3] - row[1],		// bottom, top
+		row[3] + row[2], row[3] - row[2]		// near, far
+	};
+	if (!_cullEnabled)
+		for (glm::vec4 &plane : planes)
+			plane = glm::vec4(0.0f);				// level of detail only
+
+	cl_mem shared[] = {_clPosBuffer, _clIndexBuffer, _clIndirectBuffer};
+	cl_int err = clEnqueueAcquireGLObjects(_clQueue, 3, shared, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Can't acquire GL objects");
+	err  = clEnqueueWriteBuffer(_clQueue, _clIndirectBuffer, CL_FALSE, 0, sizeof(cullReset), cullReset, 0, nullptr, nullptr);
+
+	err |= clSetKernelArg(_cullFrustum, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_cullFrustum, 1, sizeof(cl_uint), &nb);
+	for (int i = 0; i < 6; ++i)
+		err |= clSetKernelArg(_cullFrustum, 2 + i, sizeof(cl_float4), glm::value_ptr(planes[i]));
+	err |= clSetKernelArg(_cullFrustum, 8, sizeof(cl_mem), _clIndexBuffer.addr());
+	err |= clSetKernelArg(_cullFrustum, 9, sizeof(cl_mem), _clIndirectBuffer.addr());
+	err |= clSetKernelArg(_cullFrustum, 10, sizeof(float), &_lodFraction);
+	if (err != CL_SUCCESS) throw openClError("Failed to set kernel cullFrustum arguments");
+
+	size_t local = CULL_WG;
+	size_t global = ((static_cast<size_t>(nb) + local - 1) / local) * local;
+	err = clEnqueueNDRangeKernel(_clQueue, _cullFrustum, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel cullFrustum");
+	if (sorting)
+		sortVisible(mvp, nb);
+	_sortedCount = sorting ? nb : 0;
+
+	// The draw reads the count: it must be complete before GL uses it
+	clEnqueueReleaseGLObjects(_clQueue, 3, shared, 0, nullptr, nullptr);
+	clFinish(_clQueue);
+	_culled = true;
+}
+
+// Visible indices reordered back to front, in place in the index buffer.
+// bound: at most that many visible, the kernels read the real count from the command.
+// Keys are the view depth (w row of the MVP) over the depth range of the bounding box
+void ParticleSystem::sortVisible(const glm::mat4 &mvp, cl_uint bound) {
+	glm::vec4 depthRow(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+	float wNear = 0.0f, wFar = 1000.0f;
+	if (_stats.valid) {
+		wNear = INFINITY;
+		wFar = -INFINITY;
+		for (int c = 0; c < 8; ++c) {
+			glm::vec4 corner((c & 1) ? _stats.bmax.x : _stats.bmin.x,
+				(c & 2) ? _stats.bmax.y : _stats.bmin.y, (c & 4) ? _stats.bmax.z : _stats.bmin.z, 1.0f);
+			float w = glm::dot(depthRow, corner);
+			wNear = std::min(wNear, w);
+			wFar = std::max(wFar, w);
+		}
+		wNear = std::max(wNear, 0.0f);
+		wFar = std::max(wFar, wNear + 1e-3f);
+	}
+	const cl_uint bits = (_sortMode == 2) ? 8 : 16;
+
+	const size_t block = SORT_WG * SORT_ITEMS;
+	const cl_uint groups = static_cast<cl_uint>((bound + block - 1) / block);
+	const cl_uint histSize = SORT_RADIX * groups;
+	cl_mem keys[2], values[2];
+	for (int k = 0; k < 2; ++k) {
+		keys[k] = _arena.scratch(bound * sizeof(cl_uint));
+		values[k] = _arena.scratch(bound * sizeof(cl_uint));
+	}
+	cl_mem hist = _arena.scratch(histSize * sizeof(cl_uint));
+
+	cl_int err;
+	err  = clSetKernelArg(_sortKeys, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_sortKeys, 1, sizeof(cl_mem), _clIndexBuffer.addr());
+	err |= clSetKernelArg(_sortKeys, 2, sizeof(cl_mem), _clIndirectBuffer.addr());
+	err |= clSetKernelArg(_sortKeys, 3, sizeof(cl_float4), glm::value_ptr(depthRow));
+	err |= clSetKernelArg(_sortKeys, 4, sizeof(float), &wNear);
+	err |= clSetKernelArg(_sortKeys, 5, sizeof(float), &wFar);
+	err |= clSetKernelArg(_sortKeys, 6, sizeof(cl_uint), &bits);
+	err |= clSetKernelArg(_sortKeys, 7, sizeof(cl_mem), &keys[0]);
+	err |= clSetKernelArg(_sortKeys, 8, sizeof(cl_mem), &values[0]);
+	if (err != CL_SUCCESS) throw openClError("Failed to set kernel sortKeys arguments");
+
+	size_t local = SORT_WG;
+	size_t global = ((static_cast<size_t>(bound) + local - 1) / local) * local;
+	err = clEnqueueNDRangeKernel(_clQueue, _sortKeys, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel sortKeys");
+
+	// Even number of passes: the last one writes the values back to the index buffer
+	const cl_uint passes = bits / 4;
+	size_t blocks = static_cast<size_t>(groups) * SORT_WG;
+	for (cl_uint p = 0; p < passes; ++p) {
+		cl_uint shift = p * 4;
+		cl_mem srcKeys = keys[p & 1], srcValues = values[p & 1];
+		cl_mem dstKeys = keys[(p + 1) & 1];
+		cl_mem dstValues = (p + 1 == passes) ? _clIndexBuffer.get() : values[(p + 1) & 1];
+
+		err  = clSetKernelArg(_radixHistogram, 0, sizeof(cl_mem), &srcKeys);
+		err |= clSetKernelArg(_radixHistogram, 1, sizeof(cl_mem), _clIndirectBuffer.addr());
+		err |= clSetKernelArg(_radixHistogram, 2, sizeof(cl_uint), &shift);
+		err |= clSetKernelArg(_radixHistogram, 3, sizeof(cl_mem), &hist);
+
+		err |= clSetKernelArg(_radixScan, 0, sizeof(cl_mem), &hist);
+		err |= clSetKernelArg(_radixScan, 1, sizeof(cl_uint), &histSize);
+
+		err |= clSetKernelArg(_radixScatter, 0, sizeof(cl_mem), &srcKeys);
+		err |= clSetKernelArg(_radixScatter, 1, sizeof(cl_mem), &srcValues);
+		err |= clSetKernelArg(_radixScatter, 2, sizeof(cl_mem), _clIndirectBuffer.addr());
+		err |= clSetKernelArg(_radixScatter, 3, sizeof(cl_uint), &shift);
+		err |= clSetKernelArg(_radixScatter, 4, sizeof(cl_mem), &hist);
+		err |= clSetKernelArg(_radixScatter, 5, sizeof(cl_mem), &dstKeys);
+		err |= clSetKernelArg(_radixScatter, 6, sizeof(cl_mem), &dstValues);
+		if (err != CL_SUCCESS) throw openClError("Failed to set radix sort arguments");
+
+		err  = clEnqueueNDRangeKernel(_clQueue, _radixHistogram, 1, nullptr, &blocks, &local, 0, nullptr, nullptr);
+		err |= clEnqueueNDRangeKernel(_clQueue, _radixScan, 1, nullptr, &local, &local, 0, nullptr, nullptr);
+		err |= clEnqueueNDRangeKernel(_clQueue, _radixScatter, 1, nullptr, &blocks, &local, 0, nullptr, nullptr);
+		if (err != CL_SUCCESS) throw openClError("Failed to enqueue radix sort pass");
+	}
+}
+
+// Start of every frame, whatever runs it: simulation, streaming or playback
+void ParticleSystem::beginFrame() {
+	_arena.beginFrame();
+	++_frameIndex;
 }
 
 void ParticleSystem::update(float dt) {
 	_time += dt;
+	if (_compute) {
+		// No acquire, no release: a dispatch and a memory barrier
+		_compute->update(_posBuffer, _velBuffer, _colorBuffer, static_cast<GLuint>(_nbParticle),
+			dt, _time, static_cast<GLuint>(_colorMode), _speedScale);
+		return;
+	}
+	collectStats();
+	refreshField();
 	// 1 Aquiring OpenGl buffers
 	cl_int err;
-	cl_mem buffers[] = {_clPosBuffer, _clVelBuffer, _clColBuffer};
-	err = clEnqueueAcquireGLObjects(_clQueue, 3, buffers, 0, nullptr, nullptr);
-	if (err != CL_SUCCESS) throw openClError("Can't acquire GL objects");
+	acquireGLObjects();
 
 	// 2 Set kernel arguments
-	err  = clSetKernelArg(_updateSys, 0, sizeof(cl_mem), &_clPosBuffer);
-	err |= clSetKernelArg(_updateSys, 1, sizeof(cl_mem), &_clVelBuffer);
-	err |= clSetKernelArg(_updateSys, 2, sizeof(cl_mem), &_clColBuffer);
+	err  = clSetKernelArg(_updateSys, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_updateSys, 1, sizeof(cl_mem), _clVelBuffer.addr());
+	err |= clSetKernelArg(_updateSys, 2, sizeof(cl_mem), _clColBuffer.addr());
 	cl_uint nb = static_cast<cl_uint>(_nbParticle);
 	err |= clSetKernelArg(_updateSys, 3, sizeof(cl_uint), &nb);
 	err |= clSetKernelArg(_updateSys, 4, sizeof(float), &dt);
 	err |= clSetKernelArg(_updateSys, 5, sizeof(float), &_time);
 
 	int nGravityPoints = static_cast<int>(_GravityCenter.size());
-	err |= clSetKernelArg(_updateSys, 6, sizeof(cl_mem), &_clGravityBuffer);
+	err |= clSetKernelArg(_updateSys, 6, sizeof(cl_mem), _arena.addr(_gravityRegion));
 	err |= clSetKernelArg(_updateSys, 7, sizeof(cl_uint), &nGravityPoints);
 	err |= clSetKernelArg(_updateSys, 8, sizeof(cl_uint), &_colorMode);
+	err |= clSetKernelArg(_updateSys, 9, sizeof(float), &_speedScale);
+	err |= setVolumeArgs(_time);
 	if (err != CL_SUCCESS) throw openClError("Failed to set kernel updateSpace arguments");
 
 	// 3 Launch kernel
-	size_t local = 128;
-	size_t global = ((static_cast<size_t>(_nbParticle) + local - 1) / local) * local;
-	err = clEnqueueNDRangeKernel(_clQueue, _updateSys, 1, nullptr, &global, &local, 0, nullptr, nullptr);
-	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel");
+	if (_partitions.empty()) {
+		size_t local = 128;
+		size_t global = ((static_cast<size_t>(_nbParticle) + local - 1) / local) * local;
+		err = clEnqueueNDRangeKernel(_clQueue, _updateSys, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+		if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel");
+	} else
+		launchPartitions();
+
+	recordTrails();
+
+	// Only one reduction in flight: its host buffer is still being written otherwise
+	if (!_statsEvent)
+		enqueueStats(static_cast<cl_uint>(nGravityPoints));
 
 	// 4 Release buffers back to OpenGl and Flush
-	clEnqueueReleaseGLObjects(_clQueue, 3, buffers, 0, nullptr, nullptr);
+	releaseGLObjects();
 	clFlush(_clQueue);
 }
 
+// GL to GL copy of the rendered positions: the same on both paths, nothing
+// crosses the bus. Done in the GL stream before the step writes them
+void ParticleSystem::keepPrevious() {
+	glBindBuffer(GL_COPY_READ_BUFFER, _posBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _prevBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slotOffset(_hostSlot), 0,
+		drawCount() * sizeof(cl_float4));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if (_interop)
+		glFinish();		// the copy must be done before update acquires _posBuffer for CL
+	_prevValid = true;
+	fenceHostSlot();		// read like a draw
+}
+
+// Ring of trailLength slots per trail, shared with GL where TrailRenderer reads it
+void ParticleSystem::setTrails(int count, int length) {
+	count = std::max(0, std::min(count, TRAIL_MAX_COUNT));
+	length = std::max(2, std::min(length, TRAIL_MAX_LENGTH));
+	if (count == _trailCount && length == _trailLength)
+		return;
+
+	if (_clQueue) clFinish(_clQueue);
+	_clTrailBuffer.reset();
+	_trailBuffer.reset();
+	_trailCount = 0;
+	_trailLength = length;
+	_trailHead = 0;
+	_trailStride = 0;
+	if (!count || !_interop)
+		return;
+
+	const size_t size = static_cast<size_t>(count) * length * sizeof(cl_float4);
+	_trailBuffer.create(size);
+	glBindBuffer(GL_ARRAY_BUFFER, _trailBuffer);
+	glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glFinish();
+
+	cl_int err;
+	_clTrailBuffer.reset(clCreateFromGLBuffer(_clContext, CL_MEM_WRITE_ONLY, _trailBuffer, &err));
+	if (err != CL_SUCCESS) throw openClError("   \033[33mFailed to share the trail buffer\033[0m");
+	_trailCount = count;
+}
+
+// After updateSpace, positions still acquired: one slot per trail, nothing copied
+void ParticleSystem::recordTrails() {
+	if (!_trailCount || !_clTrailBuffer.get())
+		return;
+	cl_uint count = static_cast<cl_uint>(trailsDrawn());
+	cl_uint stride = std::max<cl_uint>(1, static_cast<cl_uint>(_nbParticle) / _trailCount);
+	cl_uint length = static_cast<cl_uint>(_trailLength);
+	cl_uint fill = (stride != _trailStride || _trailFrame + 1 != _frameIndex) ? 1 : 0;
+	_trailStride = stride;
+	_trailFrame = _frameIndex;
+	_trailHead = fill ? 0 : (_trailHead + 1) % length;
+
+	cl_int err = clEnqueueAcquireGLObjects(_clQueue, 1, _clTrailBuffer.addr(), 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Can't acquire the trail buffer");
+	err  = clSetKernelArg(_recordTrails, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_recordTrails, 1, sizeof(cl_uint), &stride);
+	err |= clSetKernelArg(_recordTrails, 2, sizeof(cl_uint), &count);
+	err |= clSetKernelArg(_recordTrails, 3, sizeof(cl_mem), _clTrailBuffer.addr());
+	err |= clSetKernelArg(_recordTrails, 4, sizeof(cl_uint), &length);
+	err |= clSetKernelArg(_recordTrails, 5, sizeof(cl_uint), &_trailHead);
+	err |= clSetKernelArg(_recordTrails, 6, sizeof(cl_uint), &fill);
+	if (err != CL_SUCCESS) throw openClError("Failed to set kernel recordTrails arguments");
+
+	size_t local = 128;
+	size_t global = ((static_cast<size_t>(count) + local - 1) / local) * local;
+	err = clEnqueueNDRangeKernel(_clQueue, _recordTrails, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel recordTrails");
+	clEnqueueReleaseGLObjects(_clQueue, 1, _clTrailBuffer.addr(), 0, nullptr, nullptr);
+}
+
+// Every partition runs updateSpace over its slice on its own queue (arguments 4.. are shared).
+// The main queue then waits for all of them: stats and the copy to GL see the whole range.
+void ParticleSystem::launchPartitions() {
+	std::vector<cl_event> done;
+	cl_int err;
+	for (Partition &p : _partitions) {
+		if (!p.count) continue;
+		cl_uint nb = static_cast<cl_uint>(p.count);
+		err  = clSetKernelArg(_updateSys, 0, sizeof(cl_mem), p.pos.addr());
+		err |= clSetKernelArg(_updateSys, 1, sizeof(cl_mem), p.vel.addr());
+		err |= clSetKernelArg(_updateSys, 2, sizeof(cl_mem), p.col.addr());
+		err |= clSetKernelArg(_updateSys, 3, sizeof(cl_uint), &nb);
+		err |= clSetKernelArg(_updateSys, 6, sizeof(cl_mem), p.gravity.addr());
+		if (err != CL_SUCCESS) throw openClError("Failed to set kernel updateSpace arguments");
+
+		size_t local = 128;
+		size_t global = ((p.count + local - 1) / local) * local;
+		cl_event event;
+		err = clEnqueueNDRangeKernel(p.queue, _updateSys, 1, nullptr, &global, &local, 0, nullptr, &event);
+		if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel on " + p.label);
+		clFlush(p.queue);
+		done.push_back(event);
+	}
+	clEnqueueBarrierWithWaitList(_clQueue, static_cast<cl_uint>(done.size()), done.data(), nullptr);
+	for (cl_event event : done)
+		clReleaseEvent(event);
+}
+
+// Slices sized by compute units, on boundaries clCreateSubBuffer accepts.
+// Disjoint sub-buffers can be written by several devices at once, the parent can't.
+void ParticleSystem::createPartitionBuffers() {
+	if (_partitions.empty())
+		return;
+	size_t granularity = 128;		// work-group size of updateSpace
+	cl_uint total = 0;
+	for (Partition &p : _partitions) {
+		cl_uint alignBits = 0;
+		clGetDeviceInfo(p.device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(alignBits), &alignBits, nullptr);
+		granularity = std::max(granularity, alignBits / 8 / sizeof(cl_float4));
+		total += std::max(p.weight, 1u);
+	}
+
+	cl_int err;
+	size_t offset = 0;
+	for (size_t i = 0; i < _partitions.size(); ++i) {
+		Partition &p = _partitions[i];
+		p.pos.reset();
+		p.vel.reset();
+		p.col.reset();
+		size_t share = _nbParticle * std::max(p.weight, 1u) / total / granularity * granularity;
+		p.offset = offset;
+		p.count  = (i + 1 == _partitions.size()) ? _nbParticle - offset : std::min(share, _nbParticle - offset);
+		offset  += p.count;
+		if (!p.count) continue;
+
+		cl_buffer_region region = {p.offset * sizeof(cl_float4), p.count * sizeof(cl_float4)};
+		p.pos.reset(clCreateSubBuffer(_clPosBuffer, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err));
+		if (err != CL_SUCCESS) throw openClError("Failed to create position sub-buffer for " + p.label);
+		p.vel.reset(clCreateSubBuffer(_clVelBuffer, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err));
+		if (err != CL_SUCCESS) throw openClError("Failed to create velocity sub-buffer for " + p.label);
+		p.col.reset(clCreateSubBuffer(_clColBuffer, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err));
+		if (err != CL_SUCCESS) throw openClError("Failed to create color sub-buffer for " + p.label);
+	}
+}
+
+// After a full write on the main queue (initShape, snapshot): each slice moves
+// to the memory of the node that will update it
+void ParticleSystem::migratePartitions() {
+	for (Partition &p : _partitions) {
+		if (!p.count) continue;
+		cl_mem slices[] = {p.pos, p.vel, p.col};
+		clEnqueueMigrateMemObjects(p.queue, 3, slices, 0, 0, nullptr, nullptr);
+		clFlush(p.queue);
+	}
+}
+
+void ParticleSystem::acquireGLObjects() {
+	if (!_interop)
+		return;		// the CL buffers are its own
+	cl_mem buffers[] = {_clPosBuffer, _clVelBuffer, _clColBuffer};
+	cl_int err = clEnqueueAcquireGLObjects(_clQueue, 3, buffers, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Can't acquire GL objects");
+}
+
+void ParticleSystem::releaseGLObjects(bool written) {
+	if (_interop) {
+		cl_mem buffers[] = {_clPosBuffer, _clVelBuffer, _clColBuffer};
+		clEnqueueReleaseGLObjects(_clQueue, 3, buffers, 0, nullptr, nullptr);
+	} else if (written)
+		copyToGL();
+}
+
+// Reallocation, release: nothing may read the mappings any more
+void ParticleSystem::waitDrawFences() {
+	for (GLsync &fence : _slotFence) {
+		if (!fence) continue;
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+// Drawn HOST_RING - 1 frames ago: its fence has passed unless the GPU is that far behind
+int ParticleSystem::nextHostSlot() {
+	const int slot = (_hostSlot + 1) % HOST_RING;
+	if (_slotFence[slot]) {
+		glClientWaitSync(_slotFence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(_slotFence[slot]);
+		_slotFence[slot] = nullptr;
+	}
+	return slot;
+}
+
+// Attribute offsets of the VAO, the only state that follows the slot
+void ParticleSystem::bindHostSlot(int slot) {
+	_hostSlot = slot;
+	if (!_vao)
+		return;
+	const void* offset = reinterpret_cast<const void*>(slotOffset(slot));
+	glBindVertexArray(_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, offset);
+	glBindBuffer(GL_ARRAY_BUFFER, _colorBuffer);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, offset);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void ParticleSystem::fenceHostSlot() {
+	if (!_posMapped)
+		return;
+	if (_slotFence[_hostSlot]) glDeleteSync(_slotFence[_hostSlot]);
+	_slotFence[_hostSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Copy path: map the device results for reading and hand them to OpenGL.
+// Velocities stay on the device, only what the vertex shader reads goes through.
+// With the ring, worker threads copy straight into the next slot, no GL copy, no wait
+void ParticleSystem::copyToGL() {
+	const size_t size = _nbParticle * sizeof(cl_float4);
+	cl_mem src[] = {_clPosBuffer, _clColBuffer};
+	GLuint dst[] = {_posBuffer, _colorBuffer};
+	char* mapped[] = {_posMapped, _colMapped};
+	const int slot = _posMapped ? nextHostSlot() : 0;
+
+	for (int i = 0; i < 2; ++i) {
+		cl_int err;
+		void* ptr = clEnqueueMapBuffer(_clQueue, src[i], CL_TRUE, CL_MAP_READ, 0, size, 0, nullptr, nullptr, &err);
+		if (err != CL_SUCCESS) throw openClError("Failed to map the particle buffers");
+
+		if (mapped[i]) {
+			char* to = mapped[i] + slotOffset(slot);
+			const char* from = static_cast<const char*>(ptr);
+			parallelFor((size + HOST_COPY_CHUNK - 1) / HOST_COPY_CHUNK, [&](size_t chunk) {
+				size_t begin = chunk * HOST_COPY_CHUNK;
+				std::memcpy(to + begin, from + begin, std::min(HOST_COPY_CHUNK, size - begin));
+			});
+		} else {
+			glBindBuffer(GL_ARRAY_BUFFER, dst[i]);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, ptr);
+		}
+		clEnqueueUnmapMemObject(_clQueue, src[i], ptr, 0, nullptr, nullptr);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (_posMapped)
+		bindHostSlot(slot);
+}
+
+cl_float4* ParticleSystem::mapPositions() {
+	if (_posMapped) {
+		_mappedSlot = nextHostSlot();
+		return reinterpret_cast<cl_float4*>(_posMapped + slotOffset(_mappedSlot));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+	void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, _nbParticle * sizeof(cl_float4),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!ptr) throw openGlError("   \033[33mFailed to map the position buffer\033[0m");
+	return static_cast<cl_float4*>(ptr);
+}
+
+void ParticleSystem::unmapPositions() {
+	if (_posMapped) {
+		// Coherent, nothing to flush. Colors aren't written: the slot takes the current ones on the GPU
+		glBindBuffer(GL_COPY_READ_BUFFER, _colorBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, _colorBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slotOffset(_hostSlot),
+			slotOffset(_mappedSlot), _nbParticle * sizeof(cl_float4));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		bindHostSlot(_mappedSlot);
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Host copy of the positions, for the trajectory recorder. Queued behind the
+// step, dst must stay alive until the event completes; the caller releases it
+cl_event ParticleSystem::readPositions(cl_float4* dst) {
+	if (_compute) {
+		glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, _nbParticle * sizeof(cl_float4), dst);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return nullptr;
+	}
+	cl_int err;
+	cl_event done = nullptr;
+	acquireGLObjects();
+
+	err = clEnqueueReadBuffer(_clQueue, _clPosBuffer, CL_FALSE, 0, _nbParticle * sizeof(cl_float4),
+		dst, 0, nullptr, &done);
+	releaseGLObjects(false);
+	clFlush(_clQueue);		// submitted now, the writer thread waits on it
+	if (err != CL_SUCCESS) throw openClError("Failed to read back positions");
+	return done;
+}
+
+void ParticleSystem::enqueueStats(cl_uint nGravityPoints) {
+	cl_int err;
+	cl_uint nb = static_cast<cl_uint>(_nbParticle);
+	float maxSpeed = STATS_MAX_SPEED;
+	cl_mem partials = _arena.scratch(sizeof(StatsPartial) * STATS_GROUPS, CL_MEM_WRITE_ONLY);
+
+	err  = clSetKernelArg(_reduceStats, 0, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(_reduceStats, 1, sizeof(cl_mem), _clVelBuffer.addr());
+	err |= clSetKernelArg(_reduceStats, 2, sizeof(cl_uint), &nb);
+	err |= clSetKernelArg(_reduceStats, 3, sizeof(cl_mem), _arena.addr(_gravityRegion));
+	err |= clSetKernelArg(_reduceStats, 4, sizeof(cl_uint), &nGravityPoints);
+	err |= clSetKernelArg(_reduceStats, 5, sizeof(float), &maxSpeed);
+	err |= clSetKernelArg(_reduceStats, 6, sizeof(cl_mem), &partials);
+	if (err != CL_SUCCESS) throw openClError("Failed to set kernel reduceStats arguments");
+
+	size_t local = STATS_WG;
+	size_t global = STATS_GROUPS * STATS_WG;
+	err = clEnqueueNDRangeKernel(_clQueue, _reduceStats, 1, nullptr, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel reduceStats");
+
+	// A few KB, non blocking: picked up by collectStats on a later frame
+	err = clEnqueueReadBuffer(_clQueue, partials, CL_FALSE, 0, sizeof(StatsPartial) * STATS_GROUPS,
+		_statsPartials.data(), 0, nullptr, &_statsEvent);
+	if (err != CL_SUCCESS) throw openClError("Failed to read back stats");
+}
+
+void ParticleSystem::collectStats() {
+	if (!_statsEvent)
+		return;
+	cl_int status;
+	clGetEventInfo(_statsEvent, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+	if (status > CL_COMPLETE)
+		return;		// still queued or running
+	clReleaseEvent(_statsEvent);
+	_statsEvent = nullptr;
+	if (status < 0)
+		return;		// failed, the next frame tries again
+
+	SimStats stats;
+	stats.bmin = glm::vec3(INFINITY);
+	stats.bmax = glm::vec3(-INFINITY);
+	glm::vec4 sum(0.0f);
+	float count = 0.0f;
+	for (const StatsPartial &p : _statsPartials) {
+		if (p.count == 0.0f) continue;
+		stats.bmin = glm::min(stats.bmin, glm::vec3(p.bmin[0], p.bmin[1], p.bmin[2]));
+		stats.bmax = glm::max(stats.bmax, glm::vec3(p.bmax[0], p.bmax[1], p.bmax[2]));
+		sum += glm::vec4(p.sum[0], p.sum[1], p.sum[2], p.sum[3]);
+		stats.kinetic   += p.kinetic;
+		stats.potential += p.potential;
+		stats.maxSpeed   = std::max(stats.maxSpeed, p.maxSpeed);
+		count += p.count;
+		for (int b = 0; b < STATS_BINS; ++b) stats.hist[b] += p.hist[b];
+		for (int g = 0; g < STATS_MAX_GP; ++g) stats.captured[g] += p.captured[g];
+	}
+	if (count == 0.0f)
+		return;
+
+	stats.center = glm::vec3(sum) / count;
+	stats.spread = std::sqrt(std::max(0.0f, sum.w / count - glm::dot(stats.center, stats.center)));
+
+	float seen = 0.0f;
+	int bin = 0;
+	while (bin < STATS_BINS - 1 && (seen += stats.hist[bin]) < 0.95f * count) bin++;
+	stats.speedP95 = (bin + 1) * STATS_MAX_SPEED / STATS_BINS;
+	stats.valid = true;
+	_stats = stats;
+
+	// Colors follow the actual speeds instead of a fixed 7.0
+	if (_autoSpeedScale)
+		_speedScale += (std::max(0.5f, stats.speedP95) - _speedScale) * 0.1f;
+	else
+		_speedScale = 7.0f;
+}
+
 
 // Gravity Point Management
 void ParticleSystem::addGravityPoint(float x, float y, float z, float m, bool gravity, int type) {
@@ -282,22 +1339,41 @@ void ParticleSystem::removeGravityPoint(int index) {
 	updateGravityBuffer();
 }
 
-void ParticleSystem::updateGravityBuffer() {
-	cl_int err;
+// Compared member by member, the padding of GravityPoint is not initialized
+static bool sameSources(const std::vector<GravityPoint> &a, const std::vector<GravityPoint> &b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i]._Mass != b[i]._Mass || a[i]._active != b[i]._active || a[i]._type != b[i]._type
+			|| a[i].getx() != b[i].getx() || a[i].gety() != b[i].gety() || a[i].getz() != b[i].getz())
+			return false;
+	}
+	return true;
+}
 
-	if (_clGravityBuffer) {
-		clReleaseMemObject(_clGravityBuffer);
+void ParticleSystem::updateGravityBuffer() {
+	if (_compute) {
+		_compute->setGravity(_GravityCenter);
+		return;
 	}
+	// Room for STATS_MAX_GP sources in the arena, rewritten in place
+	size_t bytes = sizeof(GravityPoint) * STATS_MAX_GP;
+	size_t used = sizeof(GravityPoint) * std::min<size_t>(_GravityCenter.size(), STATS_MAX_GP);
 
-	_clGravityBuffer = clCreateBuffer(
-		_clContext,
-		CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-		sizeof(GravityPoint) * _GravityCenter.size(),
-		_GravityCenter.data(),
-		&err
-	);
-	if (err != CL_SUCCESS)
-		throw openClError("Failed to create gravity buffer");
+	if (used)
+		clEnqueueWriteBuffer(_clQueue, _arena.get(_gravityRegion), CL_TRUE, 0, used, _GravityCenter.data(), 0, nullptr, nullptr);
+
+	// The baked field only goes stale when a source really moved or changed
+	if (!sameSources(_GravityCenter, _fieldSources))
+		_fieldStale = true;
+
+	// Split mode: broadcast, every partition reads a copy in its own memory
+	for (Partition &p : _partitions) {
+		if (!p.gravity)
+			p.gravity = _pool.buffer(CL_MEM_READ_ONLY, bytes);
+		if (used)
+			clEnqueueWriteBuffer(p.queue, p.gravity, CL_TRUE, 0, used, _GravityCenter.data(), 0, nullptr, nullptr);
+	}
 }
 
 void ParticleSystem::setGravity(bool gravityEnable) {
@@ -312,15 +1388,106 @@ void ParticleSystem::setGravity(bool gravityEnable) {
 	updateGravityBuffer();
 }
 
+// Particles already there keep their state, new ones are initialized in the
+// current shape. Buffers only move when the count leaves [capacity / 4, capacity].
 void ParticleSystem::setNbPart(int num) {
-	_nbParticle = num;
-	releaseBuffers();
+	const size_t count = static_cast<size_t>(std::max(num, 1));
+	const size_t previous = _nbParticle;
+
+	if (count > _capacity)
+		reallocate(std::max(count, _capacity + _capacity / 2));
+	else if (count < _capacity / 4)
+		reallocate(count + count / 2);
+
+	_nbParticle = count;
+	if (_clQueue) clFinish(_clQueue);
+	createPartitionBuffers();		// slices follow the count
+	if (count > previous) {
+		initializeRange(previous);
+		_prevValid = false;		// nothing kept for the new ones
+	}
+}
+
+// New buffers of the given capacity, the first min(count, capacity) particles copied over
+void ParticleSystem::reallocate(size_t capacity) {
+	if (_clQueue) clFinish(_clQueue);
+	waitDrawFences();
+	for (Partition &p : _partitions) {
+		if (p.queue) clFinish(p.queue);
+		p.pos.reset();
+		p.vel.reset();
+		p.col.reset();
+	}
+
+	// The old buffers live until the copy is done
+	GlBuffer oldGl[] = {std::move(_posBuffer), std::move(_velBuffer), std::move(_colorBuffer)};
+	ClMem oldCl[] = {std::move(_clPosBuffer), std::move(_clVelBuffer), std::move(_clColBuffer)};
+	const size_t kept = std::min(_nbParticle, capacity);
+	_posMapped = _colMapped = nullptr;		// unmapped with the old buffers
+
+	_capacity = capacity;
 	createBuffers();
 	registerInterop();
-	updateGravityBuffer();
+	createCullBuffers();
+
+	if (_compute) {
+		// GL to GL, nothing leaves the device
+		GLuint dst[] = {_posBuffer, _velBuffer, _colorBuffer};
+		for (int i = 0; i < 3; ++i) {
+			glBindBuffer(GL_COPY_READ_BUFFER, oldGl[i]);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, dst[i]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, kept * sizeof(cl_float4));
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		setupRendering();
+		return;
+	}
+
+	// Copied on the device, the GL side follows through the usual release
+	cl_mem all[] = {oldCl[0], oldCl[1], oldCl[2], _clPosBuffer, _clVelBuffer, _clColBuffer};
+	if (_interop)
+		clEnqueueAcquireGLObjects(_clQueue, 6, all, 0, nullptr, nullptr);
+	for (int i = 0; i < 3; ++i)
+		clEnqueueCopyBuffer(_clQueue, all[i], all[i + 3], 0, 0, kept * sizeof(cl_float4), 0, nullptr, nullptr);
+	if (_interop)
+		clEnqueueReleaseGLObjects(_clQueue, 6, all, 0, nullptr, nullptr);
+	clFinish(_clQueue);
+
+	size_t count = _nbParticle;
+	_nbParticle = kept;
+	if (!_interop) copyToGL();
+	_nbParticle = count;
+
+	// Copy path: plain buffers, a later resize back to that capacity reuses them
+	if (!_interop)
+		for (ClMem &mem : oldCl)
+			_pool.recycle(mem);
 	setupRendering();
 }
 
+// initShape over [first, _nbParticle): a global offset keeps the layout of a full init
+void ParticleSystem::initializeRange(size_t first) {
+	if (_compute) {
+		_compute->initShape(_posBuffer, _velBuffer, static_cast<GLuint>(first), static_cast<GLuint>(_nbParticle),
+			_radius, _shape, static_cast<GLuint>(_speed), _seed);
+		_trailStride = 0;
+		_prevValid = false;
+		return;
+	}
+	setKernel(shapeName(_shape));
+
+	acquireGLObjects();
+	size_t local = 128;
+	size_t offset = first;
+	size_t global = ((_nbParticle - first + local - 1) / local) * local;
+	cl_int err = clEnqueueNDRangeKernel(_clQueue, _initShape, 1, &offset, &global, &local, 0, nullptr, nullptr);
+	if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel initShape");
+	releaseGLObjects();
+	clFinish(_clQueue);
+	migratePartitions();
+}
+
 void ParticleSystem::setType(int type) {
 	for(auto &gp : _GravityCenter) {
 		gp._type = type;
@@ -330,44 +1497,36 @@ void ParticleSystem::setType(int type) {
 }
 
 void ParticleSystem::releaseBuffers() {
-	clFinish(_clQueue);
-
-	// OpenCl buffer, always first !
-	if (_clPosBuffer) {
-		clReleaseMemObject(_clPosBuffer);
-		_clPosBuffer = nullptr;
-	}
+	if (_clQueue) clFinish(_clQueue);
+	waitDrawFences();
 
-	if (_clVelBuffer) {
-		clReleaseMemObject(_clVelBuffer);
-		_clVelBuffer = nullptr;
+	// Sub-buffers before their parents
+	for (Partition &p : _partitions) {
+		if (p.queue) clFinish(p.queue);
+		p.pos.reset();
+		p.vel.reset();
+		p.col.reset();
 	}
 
-	if (_clColBuffer) {
-		clReleaseMemObject(_clColBuffer);
-		_clColBuffer = nullptr;
-	}
-
-	if (_clGravityBuffer) {
-		clReleaseMemObject(_clGravityBuffer);
-		_clGravityBuffer = nullptr;
-	}
-
-	// OpenGl buffer
-	if (_posBuffer) {
-		glDeleteBuffers(1, &_posBuffer);
-		_posBuffer = 0;
-	}
-
-	if (_velBuffer) {
-		glDeleteBuffers(1, &_velBuffer);
-		_velBuffer = 0;
-	}
+	// OpenCl buffer, always first !
+	_clIndexBuffer.reset();
+	_clIndirectBuffer.reset();
+	_clTrailBuffer.reset();
+	_clPosBuffer.reset();
+	_clVelBuffer.reset();
+	_clColBuffer.reset();
 
-	if (_colorBuffer) {
-		glDeleteBuffers(1, &_colorBuffer);
-		_colorBuffer = 0;
-	}
+	// OpenGl buffer, deleting unmaps the persistent mappings
+	_posMapped = nullptr;
+	_colMapped = nullptr;
+	_posBuffer.reset();
+	_velBuffer.reset();
+	_prevBuffer.reset();
+	_colorBuffer.reset();
+	_indexBuffer.reset();
+	_indirectBuffer.reset();
+	_trailBuffer.reset();
+	_trailCount = 0;
 }
 
 void ParticleSystem::updatePositionGP(int id, float x, float y, float z, float m) {
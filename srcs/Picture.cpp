@@ -0,0 +1,121 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Picture.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 23:54:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 00:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "Picture.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO			// decoded from the mapping
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+
+bool isPicturePath(const std::string &path) {
+	const size_t dot = path.rfind('.');
+	if (dot == std::string::npos)
+		return false;
+	std::string ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	return ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "bmp" || ext == "tga" || ext == "psd" || ext == "gif";
+}
+
+// Rows are independent: each one is summed and normalized by its own task,
+// only the marginal over the rows is a sequential pass
+void readPicture(const std::string &path, Picture &picture) {
+	MappedFile file;
+	file.open(path);
+	if (file.size() > INT_MAX)
+		throw fileError("   \033[33m" + path + " is too large\033[0m");
+
+	int channels;
+	unsigned char* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()),
+		&picture.width, &picture.height, &channels, 4);
+	if (!pixels)
+		throw fileError("   \033[33mCan't decode " + path + ": " + stbi_failure_reason() + "\033[0m");
+	const size_t width = picture.width, height = picture.height;
+	picture.rgba.assign(pixels, pixels + width * height * 4);
+	stbi_image_free(pixels);
+
+	picture.pixelCdf.resize(width * height);
+	picture.rowCdf.resize(height);
+	std::vector<double> rowSums(height);
+	parallelFor(height, [&](size_t y) {
+		const unsigned char* row = picture.rgba.data() + y * width * 4;
+		float* cdf = picture.pixelCdf.data() + y * width;
+		double sum = 0.0;
+		for (size_t x = 0; x < width; ++x) {
+			const unsigned char* p = row + 4 * x;
+			sum += (0.2126 * p[0] + 0.7152 * p[1] + 0.0722 * p[2]) * p[3] / (255.0 * 255.0);
+			cdf[x] = static_cast<float>(sum);
+		}
+		for (size_t x = 0; x < width; ++x)		// a black row is never picked, any ramp will do
+			cdf[x] = sum > 0.0 ? static_cast<float>(cdf[x] / sum) : static_cast<float>(x + 1) / width;
+		rowSums[y] = sum;
+	});
+
+	double total = 0.0;
+	for (size_t y = 0; y < height; ++y) {
+		total += rowSums[y];
+		rowSums[y] = total;
+	}
+	if (total <= 0.0)
+		throw fileError("   \033[33m" + path + " is black, nothing to emit\033[0m");
+	for (size_t y = 0; y < height; ++y)
+		picture.rowCdf[y] = static_cast<float>(rowSums[y] / total);
+}
+
+// Decoded and tabulated on the host, uploaded once: initShape samples in parallel
+void ParticleSystem::loadPicture(const std::string &path) {
+	if (_compute)
+		throw fileError("   \033[33mImage shapes need the OpenCL backend\033[0m");
+	if (!_fieldImages)
+		throw fileError("   \033[33mImage shapes need OpenCL image support\033[0m");
+	const auto start = std::chrono::steady_clock::now();
+	Picture picture;
+	readPicture(path, picture);
+
+	cl_image_format format = {CL_RGBA, CL_UNORM_INT8};
+	cl_image_desc desc = {};
+	desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+	desc.image_width = picture.width;
+	desc.image_height = picture.height;
+
+	cl_int err;
+	ClMem image(clCreateImage(_clContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, &format, &desc,
+		picture.rgba.data(), &err));
+	if (err != CL_SUCCESS)
+		throw openClError("   \033[33mFailed to create the picture image\033[0m");
+
+	const size_t pixels = picture.pixelCdf.size();
+	ClMem rows = _pool.buffer(CL_MEM_READ_ONLY, picture.rowCdf.size() * sizeof(float));
+	ClMem cdf = _pool.buffer(CL_MEM_READ_ONLY, pixels * sizeof(float));
+	err  = clEnqueueWriteBuffer(_clQueue, rows, CL_FALSE, 0, picture.rowCdf.size() * sizeof(float),
+		picture.rowCdf.data(), 0, nullptr, nullptr);
+	err |= clEnqueueWriteBuffer(_clQueue, cdf, CL_FALSE, 0, pixels * sizeof(float), picture.pixelCdf.data(), 0, nullptr, nullptr);
+	clFinish(_clQueue);		// the host tables must outlive the writes
+	if (err != CL_SUCCESS) throw openClError("Failed to upload the picture tables");
+
+	_pool.recycle(_pictureRows);
+	_pool.recycle(_picturePixels);
+	_picture = std::move(image);
+	_pictureRows = std::move(rows);
+	_picturePixels = std::move(cdf);
+	_pictureWidth = static_cast<cl_uint>(picture.width);
+	_pictureHeight = static_cast<cl_uint>(picture.height);
+	_picturePath = path;
+	_pictureLoadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,327 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   PointCloud.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 00:39:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:34:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "PointCloud.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#define PLY_HEADER_MAX		(std::size_t(64) << 10)	// bytes searched for end_header
+
+static const uint32_t cloudTypeSize[] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+// Integer colors are normalized by the largest value of their type
+static const double cloudColorScale[] = {127.0, 255.0, 32767.0, 65535.0, 2147483647.0, 4294967295.0, 1.0, 1.0};
+
+bool isPlyPath(const std::string &path) {
+	const size_t dot = path.rfind('.');
+	if (dot == std::string::npos)
+		return false;
+	std::string ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	return ext == "ply";
+}
+
+static bool parseCloudType(const std::string &name, CloudType &type) {
+	static const char* names[][2] = {
+		{"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"}, {"ushort", "uint16"},
+		{"int", "int32"}, {"uint", "uint32"}, {"float", "float32"}, {"double", "float64"}};
+	for (int i = 0; i < 8; ++i) {
+		if (name == names[i][0] || name == names[i][1]) {
+			type = static_cast<CloudType>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline double readScalar(const unsigned char* p, CloudType type, bool swap) {
+	unsigned char bytes[8];
+	if (swap) {
+		const uint32_t n = cloudTypeSize[type];
+		for (uint32_t i = 0; i < n; ++i)
+			bytes[i] = p[n - 1 - i];
+		p = bytes;
+	}
+	switch (type) {
+		case CLOUD_I8:  return static_cast<int8_t>(p[0]);
+		case CLOUD_U8:  return p[0];
+		case CLOUD_I16: { int16_t v;  std::memcpy(&v, p, 2); return v; }
+		case CLOUD_U16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+		case CLOUD_I32: { int32_t v;  std::memcpy(&v, p, 4); return v; }
+		case CLOUD_U32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+		case CLOUD_F32: { float v;    std::memcpy(&v, p, 4); return v; }
+		case CLOUD_F64: { double v;   std::memcpy(&v, p, 8); return v; }
+	}
+	return 0.0;
+}
+
+static void setVertexProperty(CloudLayout &layout, const std::string &name, CloudType type, uint32_t offset) {
+	static const char* names[][3] = {
+		{"x", "y", "z"}, {"red", "green", "blue"}, {"r", "g", "b"}, {"vx", "vy", "vz"}};
+	CloudAttr* attrs[] = {layout.pos, layout.col, layout.col, layout.vel};
+	for (int a = 0; a < 4; ++a) {
+		for (int i = 0; i < 3; ++i) {
+			if (name == names[a][i]) {
+				attrs[a][i].offset = static_cast<int32_t>(offset);
+				attrs[a][i].type = type;
+			}
+		}
+	}
+	if (name == "alpha" || name == "a") {
+		layout.col[3].offset = static_cast<int32_t>(offset);
+		layout.col[3].type = type;
+	}
+}
+
+// Raw: everything follows from the record size. PLY: the vertex records are
+// located from the header, the elements before them skipped by their size
+void readCloudLayout(const std::string &path, const unsigned char* data, size_t size, int rawStride, CloudLayout &layout) {
+	layout = CloudLayout();
+	if (!isPlyPath(path)) {
+		if (rawStride != 3 && rawStride != 4 && rawStride != 6 && rawStride != 9)
+			throw fileError("   \033[33mRaw point clouds hold 3, 4, 6 or 9 floats per point\033[0m");
+		layout.raw = true;
+		layout.stride = static_cast<uint32_t>(rawStride * sizeof(float));
+		if (size == 0 || size % layout.stride != 0)
+			throw fileError("   \033[33m" + path + " is not made of " + std::to_string(rawStride) + " float records\033[0m");
+		layout.count = size / layout.stride;
+		for (int i = 0; i < 3; ++i) {
+			layout.pos[i].offset = 4 * i;
+			if (rawStride >= 6) layout.col[i].offset = 12 + 4 * i;
+			if (rawStride == 9) layout.vel[i].offset = 24 + 4 * i;
+		}
+		return;
+	}
+
+	const std::string text(reinterpret_cast<const char*>(data), std::min(size, PLY_HEADER_MAX));
+	const size_t end = text.find("end_header");
+	const size_t eol = end == std::string::npos ? end : text.find('\n', end);
+	if (text.compare(0, 3, "ply") != 0 || eol == std::string::npos)
+		throw fileError("   \033[33m" + path + " is not a PLY file\033[0m");
+
+	// Element being read: its record size, and whether a list makes it variable
+	std::string element;
+	uint64_t elementCount = 0;
+	uint32_t elementSize = 0;
+	bool elementList = false;
+	bool vertexDone = false;
+	uint64_t skipped = 0;
+	auto closeElement = [&]() {
+		if (element == "vertex") {
+			if (elementList)
+				throw fileError("   \033[33mList properties in the vertices of " + path + "\033[0m");
+			layout.count = elementCount;
+			layout.stride = elementSize;
+			vertexDone = true;
+		} else if (!element.empty() && !vertexDone) {
+			if (elementList)
+				throw fileError("   \033[33mList properties before the vertices of " + path + "\033[0m");
+			skipped += elementCount * elementSize;
+		}
+	};
+
+	std::istringstream lines(text.substr(0, end));
+	std::string line;
+	bool format = false;
+	while (std::getline(lines, line)) {
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+		if (keyword == "format") {
+			std::string encoding;
+			words >> encoding;
+			if (encoding == "ascii")
+				throw fileError("   \033[33mASCII PLY isn't supported, convert " + path + " to binary\033[0m");
+			if (encoding != "binary_little_endian" && encoding != "binary_big_endian")
+				throw fileError("   \033[33mUnknown PLY format in " + path + "\033[0m");
+			layout.swap = encoding == "binary_big_endian";
+			format = true;
+		} else if (keyword == "element") {
+			closeElement();
+			element.clear();
+			words >> element >> elementCount;
+			elementSize = 0;
+			elementList = false;
+		} else if (keyword == "property") {
+			std::string typeName, name;
+			words >> typeName >> name;
+			CloudType type;
+			if (typeName == "list")
+				elementList = true;
+			else if (!parseCloudType(typeName, type))
+				throw fileError("   \033[33mUnknown PLY type " + typeName + " in " + path + "\033[0m");
+			else {
+				if (element == "vertex")
+					setVertexProperty(layout, name, type, elementSize);
+				elementSize += cloudTypeSize[type];
+			}
+		}
+	}
+	closeElement();
+
+	if (!format || !vertexDone || layout.pos[0].offset < 0 || layout.pos[1].offset < 0 || layout.pos[2].offset < 0)
+		throw fileError("   \033[33mNo vertex positions in " + path + "\033[0m");
+	if (layout.col[0].offset < 0 || layout.col[1].offset < 0 || layout.col[2].offset < 0)
+		layout.col[0].offset = -1;		// partial colors: none
+	if (layout.vel[0].offset < 0 || layout.vel[1].offset < 0 || layout.vel[2].offset < 0)
+		layout.vel[0].offset = -1;
+	layout.start = eol + 1 + skipped;
+	if (layout.stride == 0 || layout.start + layout.count * layout.stride > size)
+		throw fileError("   \033[33mTruncated PLY file " + path + "\033[0m");
+}
+
+void cloudBounds(const unsigned char* data, const CloudLayout &layout, glm::dvec3 &bmin, glm::dvec3 &bmax) {
+	const size_t tasks = (layout.count + CLOUD_TASK - 1) / CLOUD_TASK;
+	std::vector<glm::dvec3> mins(tasks, glm::dvec3(1e300)), maxs(tasks, glm::dvec3(-1e300));
+	parallelFor(tasks, [&](size_t task) {
+		const size_t end = std::min<size_t>(layout.count, (task + 1) * CLOUD_TASK);
+		for (size_t i = task * CLOUD_TASK; i < end; ++i) {
+			const unsigned char* record = data + layout.start + i * layout.stride;
+			glm::dvec3 p;
+			for (int c = 0; c < 3; ++c)
+				p[c] = readScalar(record + layout.pos[c].offset, layout.pos[c].type, layout.swap);
+			mins[task] = glm::min(mins[task], p);
+			maxs[task] = glm::max(maxs[task], p);
+		}
+	});
+	bmin = glm::dvec3(1e300);
+	bmax = glm::dvec3(-1e300);
+	for (size_t t = 0; t < tasks; ++t) {
+		bmin = glm::min(bmin, mins[t]);
+		bmax = glm::max(bmax, maxs[t]);
+	}
+}
+
+void decodeCloud(const unsigned char* data, const CloudLayout &layout, const CloudTransform &transform,
+	size_t first, size_t n, cl_float4* pos, cl_float4* col, cl_float4* vel) {
+	const bool colors = layout.hasColors(), velocities = layout.hasVelocities(), alpha = layout.col[3].offset >= 0;
+	for (size_t i = 0; i < n; ++i) {
+		const unsigned char* record = data + layout.start + (first + i) * layout.stride;
+		if (pos) {
+			glm::dvec3 p;
+			for (int c = 0; c < 3; ++c)
+				p[c] = readScalar(record + layout.pos[c].offset, layout.pos[c].type, layout.swap);
+			p = (p - transform.center) * transform.scale;
+			pos[i] = {{static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z), 1.0f}};
+		}
+		if (col) {
+			cl_float4 c = {{1.0f, 1.0f, 1.0f, 1.0f}};
+			for (int k = 0; colors && k < (alpha ? 4 : 3); ++k)
+				c.s[k] = static_cast<float>(readScalar(record + layout.col[k].offset, layout.col[k].type, layout.swap)
+					/ cloudColorScale[layout.col[k].type]);
+			col[i] = c;
+		}
+		if (vel) {
+			cl_float4 v = {{0.0f, 0.0f, 0.0f, 0.0f}};
+			for (int k = 0; velocities && k < 3; ++k)
+				v.s[k] = static_cast<float>(readScalar(record + layout.vel[k].offset, layout.vel[k].type, layout.swap)
+					* transform.scale);
+			vel[i] = v;
+		}
+	}
+}
+
+// The device buffers are mapped one chunk at a time and every host thread decodes
+// a slice of the records into them, while the next chunk of the file is read ahead.
+// Every layout goes through the decoder: it is what sets w to 1
+void ParticleSystem::loadPointCloud(const std::string &path, int rawStride, float fitRadius) {
+	const auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	file.open(path);
+	CloudLayout layout;
+	readCloudLayout(path, file.data(), file.size(), rawStride, layout);
+	if (layout.count == 0 || layout.count > INT_MAX)
+		throw fileError("   \033[33m" + path + " holds " + std::to_string(layout.count) + " points\033[0m");
+
+	// Fitted: centered on the origin, the largest half extent brought to fitRadius
+	CloudTransform transform;
+	if (fitRadius > 0.0f) {
+		glm::dvec3 bmin, bmax;
+		cloudBounds(file.data(), layout, bmin, bmax);
+		const glm::dvec3 half = (bmax - bmin) * 0.5;
+		const double extent = std::max(half.x, std::max(half.y, half.z));
+		transform.center = (bmin + bmax) * 0.5;
+		transform.scale = extent > 0.0 ? fitRadius / extent : 1.0;
+	}
+
+	if (layout.count != _nbParticle)
+		setNbPart(static_cast<int>(layout.count));
+	_trailStride = 0;
+	_prevValid = false;
+	const size_t count = _nbParticle;
+
+	cl_int err = CL_SUCCESS;
+	if (!_compute)
+		acquireGLObjects();
+	cl_mem clBuffers[] = {_clPosBuffer, _clColBuffer, _clVelBuffer};
+	GLuint glBuffers[] = {_posBuffer, _colorBuffer, _velBuffer};
+
+	for (size_t first = 0; first < count && err == CL_SUCCESS; first += CLOUD_CHUNK) {
+		const size_t n = std::min(CLOUD_CHUNK, count - first);
+		const size_t next = first + n;
+		if (next < count)
+			file.prefetch(layout.start + next * layout.stride, std::min(CLOUD_CHUNK, count - next) * layout.stride);
+
+		cl_float4* dst[] = {nullptr, nullptr, nullptr};		// pos, col, vel
+		for (int i = 0; i < 3; ++i) {
+			if (_compute) {
+				glBindBuffer(GL_ARRAY_BUFFER, glBuffers[i]);
+				dst[i] = static_cast<cl_float4*>(glMapBufferRange(GL_ARRAY_BUFFER, first * sizeof(cl_float4),
+					n * sizeof(cl_float4), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+				if (!dst[i]) throw openGlError("   \033[33mFailed to map the particle buffers\033[0m");
+			} else {
+				dst[i] = static_cast<cl_float4*>(clEnqueueMapBuffer(_clQueue, clBuffers[i], CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+					first * sizeof(cl_float4), n * sizeof(cl_float4), 0, nullptr, nullptr, &err));
+				if (err != CL_SUCCESS) throw openClError("Failed to map the particle buffers");
+			}
+		}
+
+		parallelFor((n + CLOUD_TASK - 1) / CLOUD_TASK, [&](size_t task) {
+			const size_t begin = task * CLOUD_TASK;
+			const size_t size = std::min<size_t>(CLOUD_TASK, n - begin);
+			decodeCloud(file.data(), layout, transform, first + begin, size,
+				dst[0] + begin, dst[1] + begin, dst[2] + begin);
+		});
+
+		for (int i = 0; i < 3; ++i) {
+			if (_compute) {
+				glBindBuffer(GL_ARRAY_BUFFER, glBuffers[i]);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+			} else
+				err |= clEnqueueUnmapMemObject(_clQueue, clBuffers[i], dst[i], 0, nullptr, nullptr);
+		}
+	}
+
+	if (_compute)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	else {
+		releaseGLObjects();
+		clFinish(_clQueue);
+		migratePartitions();
+	}
+	if (err != CL_SUCCESS) throw openClError("Failed to upload the point cloud");
+
+	_cloudColors = layout.hasColors();
+	if (_cloudColors)
+		_colorMode = 3;		// the colors of the file, kept by updateSpace
+	_cloudPath = path;
+	_cloudLoadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
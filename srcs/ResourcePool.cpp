@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResourcePool.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 15:24:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 16:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ResourcePool.hpp"
+
+// Constructeur
+ResourcePool::ResourcePool(): _context(nullptr), _program(nullptr), _pooledBytes(0) {}
+
+ResourcePool::~ResourcePool() {
+	clear();
+}
+
+cl_kernel ResourcePool::kernel(const std::string &name) {
+	auto it = _kernels.find(name);
+	if (it != _kernels.end())
+		return it->second;
+
+	cl_int err;
+	cl_kernel kernel = clCreateKernel(_program, name.c_str(), &err);
+	if (err != CL_SUCCESS)
+		throw openClError("    \033[33mFailed to create kernel " + name + "\033[0m");
+	_kernels[name].reset(kernel);
+	return kernel;
+}
+
+cl_command_queue ResourcePool::queue(cl_device_id device, const std::string &role) {
+	ClQueue &queue = _queues[std::make_pair(device, role)];
+	if (!queue) {
+		cl_int err;
+		queue.reset(clCreateCommandQueue(_context, device, 0, &err));
+		if (err != CL_SUCCESS)
+			throw openClError("Failed to create OpenCL command queue (" + role + ")");
+	}
+	return queue;
+}
+
+ClMem ResourcePool::buffer(cl_mem_flags flags, size_t size) {
+	auto it = _free.find(std::make_pair(flags, size));
+	if (it != _free.end()) {
+		ClMem buffer = std::move(it->second);
+		_free.erase(it);
+		_pooledBytes -= size;
+		return buffer;
+	}
+
+	cl_int err;
+	ClMem buffer(clCreateBuffer(_context, flags, size, nullptr, &err));
+	if (err != CL_SUCCESS)
+		throw openClError("Failed to create a buffer of " + std::to_string(size) + " bytes");
+	return buffer;
+}
+
+void ResourcePool::recycle(ClMem &buffer) {
+	if (!buffer)
+		return;
+	cl_mem parent = nullptr;
+	cl_mem_flags flags = 0;
+	size_t size = 0;
+	clGetMemObjectInfo(buffer, CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(parent), &parent, nullptr);
+	clGetMemObjectInfo(buffer, CL_MEM_FLAGS, sizeof(flags), &flags, nullptr);
+	clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size), &size, nullptr);
+
+	// Sub-buffers and host pointers can't be handed out again
+	if (parent || (flags & (CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR)) || _pooledBytes + size > POOL_MAX_BYTES) {
+		buffer.reset();
+		return;
+	}
+	_pooledBytes += size;
+	_free.emplace(std::make_pair(flags, size), std::move(buffer));
+}
+
+void ResourcePool::trim() {
+	_free.clear();
+	_pooledBytes = 0;
+}
+
+void ResourcePool::clear() {
+	trim();
+	_kernels.clear();
+	_queues.clear();
+}
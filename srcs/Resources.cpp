@@ -0,0 +1,68 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Resources.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 15:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 16:09:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Resources.hpp"
+
+ResourceCounters& resourceCounters() {
+	static ResourceCounters counters;
+	return counters;
+}
+
+static long long memBytes(cl_mem mem) {
+	cl_mem parent = nullptr;
+	clGetMemObjectInfo(mem, CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(parent), &parent, nullptr);
+	if (parent)
+		return 0;
+	size_t size = 0;
+	clGetMemObjectInfo(mem, CL_MEM_SIZE, sizeof(size), &size, nullptr);
+	return static_cast<long long>(size);
+}
+
+void ClTraits<cl_mem>::adopt(cl_mem mem) {
+	resourceCounters().buffers++;
+	resourceCounters().bufferBytes += memBytes(mem);
+}
+
+void ClTraits<cl_mem>::drop(cl_mem mem) {
+	resourceCounters().buffers--;
+	resourceCounters().bufferBytes -= memBytes(mem);
+	clReleaseMemObject(mem);
+}
+
+GlBuffer &GlBuffer::operator=(GlBuffer &&other) noexcept {
+	if (this != &other) {
+		reset();
+		_id = other._id;
+		_bytes = other._bytes;
+		other._id = 0;
+		other._bytes = 0;
+	}
+	return *this;
+}
+
+void GlBuffer::create(size_t bytes) {
+	reset();
+	glGenBuffers(1, &_id);
+	_bytes = bytes;
+	resourceCounters().glBuffers++;
+	resourceCounters().glBufferBytes += static_cast<long long>(bytes);
+}
+
+void GlBuffer::reset() {
+	if (!_id)
+		return;
+	glDeleteBuffers(1, &_id);
+	resourceCounters().glBuffers--;
+	resourceCounters().glBufferBytes -= static_cast<long long>(_bytes);
+	_id = 0;
+	_bytes = 0;
+}
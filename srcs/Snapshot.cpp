@@ -0,0 +1,141 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Snapshot.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 09:29:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 21:04:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "Snapshot.hpp"
+#include "MappedFile.hpp"
+
+#include <climits>
+#include <cstring>
+
+// The file is created at its final size and mapped: the device writes
+// straight into the page cache, nothing is staged in a std::vector
+void ParticleSystem::saveSnapshot(const std::string &path) {
+	const uint64_t attrSize = static_cast<uint64_t>(_nbParticle) * sizeof(cl_float4);
+
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version       = SNAPSHOT_VERSION;
+	header.headerSize    = sizeof(SnapshotHeader);
+	header.nbParticle    = _nbParticle;
+	header.shape         = _shape;
+	header.speed         = _speed;
+	header.colorMode     = _colorMode;
+	header.gravityEnable = _gravityEnable;
+	header.time          = _time;
+	header.radius        = _radius;
+	header.seed          = _seed;
+	header.nGravity      = static_cast<uint32_t>(_GravityCenter.size());
+
+	header.gravityOffset = sizeof(SnapshotHeader);
+	header.posOffset     = snapshotAlign(header.gravityOffset + sizeof(GravityPoint) * header.nGravity);
+	header.velOffset     = snapshotAlign(header.posOffset + attrSize);
+	header.colOffset     = snapshotAlign(header.velOffset + attrSize);
+	header.fileSize      = header.colOffset + attrSize;
+
+	MappedFile file;
+	file.create(path, header.fileSize);
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + header.gravityOffset, _GravityCenter.data(),
+		sizeof(GravityPoint) * header.nGravity);
+
+	// GL compute: the particles only live in the GL buffers
+	if (_compute) {
+		GLuint src[] = {_posBuffer, _velBuffer, _colorBuffer};
+		uint64_t offsets[] = {header.posOffset, header.velOffset, header.colOffset};
+		for (int i = 0; i < 3; ++i) {
+			glBindBuffer(GL_ARRAY_BUFFER, src[i]);
+			glGetBufferSubData(GL_ARRAY_BUFFER, 0, attrSize, file.data() + offsets[i]);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	cl_int err;
+	acquireGLObjects();
+
+	err  = clEnqueueReadBuffer(_clQueue, _clPosBuffer, CL_FALSE, 0, attrSize, file.data() + header.posOffset, 0, nullptr, nullptr);
+	err |= clEnqueueReadBuffer(_clQueue, _clVelBuffer, CL_FALSE, 0, attrSize, file.data() + header.velOffset, 0, nullptr, nullptr);
+	err |= clEnqueueReadBuffer(_clQueue, _clColBuffer, CL_FALSE, 0, attrSize, file.data() + header.colOffset, 0, nullptr, nullptr);
+
+	releaseGLObjects(false);
+	clFinish(_clQueue);
+	if (err != CL_SUCCESS) throw openClError("Failed to read back particle buffers");
+}
+
+// Header checks only: attribute blocks go from the mapping to the device as is
+void ParticleSystem::loadSnapshot(const std::string &path) {
+	MappedFile file;
+	file.open(path);
+
+	if (file.size() < sizeof(SnapshotHeader))
+		throw fileError("   \033[33m" + path + " is not a snapshot\033[0m");
+	SnapshotHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+		throw fileError("   \033[33m" + path + " is not a snapshot\033[0m");
+	if (header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader))
+		throw fileError("   \033[33mUnsupported snapshot version in " + path + "\033[0m");
+
+	const uint64_t attrSize = header.nbParticle * sizeof(cl_float4);
+	if (header.nbParticle == 0 || header.nbParticle > INT_MAX || header.nGravity > 8
+		|| header.fileSize != file.size()
+		|| header.gravityOffset + sizeof(GravityPoint) * header.nGravity > header.posOffset
+		|| header.posOffset + attrSize > header.velOffset
+		|| header.velOffset + attrSize > header.colOffset
+		|| header.colOffset + attrSize > file.size())
+		throw fileError("   \033[33mCorrupted snapshot " + path + "\033[0m");
+
+	if (header.nbParticle != _nbParticle)
+		setNbPart(static_cast<int>(header.nbParticle));
+
+	_shape         = header.shape;
+	_speed         = header.speed;
+	_colorMode     = header.colorMode;
+	_gravityEnable = header.gravityEnable;
+	_time          = header.time;
+	_trailStride   = 0;
+	_prevValid     = false;
+	_radius        = header.radius;
+	_seed          = header.seed;
+
+	const GravityPoint* gp = reinterpret_cast<const GravityPoint*>(file.data() + header.gravityOffset);
+	_GravityCenter.assign(gp, gp + header.nGravity);
+	_nGravityPos = static_cast<int>(_GravityCenter.size());
+	updateGravityBuffer();
+
+	if (_compute) {
+		GLuint dst[] = {_posBuffer, _velBuffer, _colorBuffer};
+		uint64_t offsets[] = {header.posOffset, header.velOffset, header.colOffset};
+		for (int i = 0; i < 3; ++i) {
+			glBindBuffer(GL_ARRAY_BUFFER, dst[i]);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, attrSize, file.data() + offsets[i]);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	cl_int err;
+	acquireGLObjects();
+
+	err  = clEnqueueWriteBuffer(_clQueue, _clPosBuffer, CL_FALSE, 0, attrSize, file.data() + header.posOffset, 0, nullptr, nullptr);
+	err |= clEnqueueWriteBuffer(_clQueue, _clVelBuffer, CL_FALSE, 0, attrSize, file.data() + header.velOffset, 0, nullptr, nullptr);
+	err |= clEnqueueWriteBuffer(_clQueue, _clColBuffer, CL_FALSE, 0, attrSize, file.data() + header.colOffset, 0, nullptr, nullptr);
+
+	// The mapping must outlive the non blocking writes
+	releaseGLObjects();
+	clFinish(_clQueue);
+	migratePartitions();
+	if (err != CL_SUCCESS) throw openClError("Failed to upload snapshot buffers");
+}
@@ -0,0 +1,290 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Streaming.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 14:14:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 23:24:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "Streaming.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t streamAlign(uint64_t offset) {
+	return (offset + STREAM_ALIGN - 1) / STREAM_ALIGN * STREAM_ALIGN;
+}
+
+StreamState::~StreamState() {
+	if (io) clFinish(io);
+}
+
+// count == 0: resume the file as it is, otherwise a new file initialized with
+// the current shape, seed and speed mode
+void ParticleSystem::startStreaming(const std::string &path, uint64_t count) {
+	stopStreaming();
+	if (_compute)
+		throw openClError("   \033[33mStreaming runs on the OpenCL backend only\033[0m");
+	if (count > STREAM_MAX)
+		throw inputError("   \033[33mAt most 4 billion particles can be streamed\033[0m");
+
+	std::unique_ptr<StreamState> stream = std::make_unique<StreamState>();
+	StreamState &st = *stream;
+	st.path = path;
+
+	if (count == 0) {
+		st.file.openShared(path);
+		if (st.file.size() < sizeof(StreamHeader))
+			throw fileError("   \033[33m" + path + " is not a particle stream\033[0m");
+		std::memcpy(&st.header, st.file.data(), sizeof(st.header));
+		const StreamHeader &h = st.header;
+		if (std::memcmp(h.magic, STREAM_MAGIC, sizeof(h.magic)) != 0)
+			throw fileError("   \033[33m" + path + " is not a particle stream\033[0m");
+		if (h.version != STREAM_VERSION || h.headerSize != sizeof(StreamHeader))
+			throw fileError("   \033[33mUnsupported stream version in " + path + "\033[0m");
+		if (h.nbParticle == 0 || h.nbParticle > STREAM_MAX
+			|| h.posOffset + h.nbParticle * sizeof(cl_float4) > h.velOffset
+			|| h.velOffset + h.nbParticle * sizeof(cl_float4) > st.file.size())
+			throw fileError("   \033[33mCorrupted stream " + path + "\033[0m");
+	} else {
+		StreamHeader &h = st.header;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, STREAM_MAGIC, sizeof(h.magic));
+		h.version    = STREAM_VERSION;
+		h.headerSize = sizeof(StreamHeader);
+		h.nbParticle = count;
+		h.posOffset  = streamAlign(sizeof(StreamHeader));
+		h.velOffset  = streamAlign(h.posOffset + count * sizeof(cl_float4));
+		h.shape      = _shape;
+		h.seed       = _seed;
+		h.radius     = _radius;
+		h.speed      = static_cast<uint32_t>(_speed);
+		st.file.create(path, h.velOffset + count * sizeof(cl_float4));
+		std::memcpy(st.file.data(), &h, sizeof(h));
+	}
+	st.nChunks = (st.header.nbParticle + STREAM_CHUNK - 1) / STREAM_CHUNK;
+
+	// Copies get their own queue so that they overlap the kernels of the main one
+	st.io = _pool.queue(_contextDevices.front(), "io");
+	st.decimate = _pool.kernel("decimate");
+
+	// Chunk buffers come back from the pool when streaming restarts
+	const size_t bytes = STREAM_CHUNK * sizeof(cl_float4);
+	for (int s = 0; s < 2; ++s) {
+		st.pos[s] = _pool.buffer(CL_MEM_READ_WRITE, bytes);
+		st.vel[s] = _pool.buffer(CL_MEM_READ_WRITE, bytes);
+		st.col[s] = _pool.buffer(CL_MEM_READ_WRITE, bytes);
+	}
+
+	_stream = std::move(stream);
+	_time = _stream->header.time;
+	if (count != 0) {
+		try {
+			streamInit();
+		} catch (...) {
+			_stream.reset();
+			throw;
+		}
+	}
+}
+
+void ParticleSystem::stopStreaming() {
+	if (_stream) {
+		clFinish(_stream->io);
+		clFinish(_clQueue);
+		for (int s = 0; s < 2; ++s) {
+			_pool.recycle(_stream->pos[s]);
+			_pool.recycle(_stream->vel[s]);
+			_pool.recycle(_stream->col[s]);
+		}
+	}
+	_stream.reset();		// the mapping is synced when the file closes
+}
+
+// initShape chunk after chunk, each chunk written back to the file
+void ParticleSystem::streamInit() {
+	StreamState &st = *_stream;
+	const StreamHeader &h = st.header;
+	cl_uint nb = static_cast<cl_uint>(h.nbParticle);
+	cl_uint nGravityPoints = static_cast<cl_uint>(_GravityCenter.size());
+	int flag = shapeFlag(shapeName(h.shape));		// a mesh shape needs the mesh loaded
+
+	cl_int err;
+	err  = clSetKernelArg(_initShape, 3, sizeof(cl_uint), &nb);
+	err |= clSetKernelArg(_initShape, 4, sizeof(float), &h.radius);
+	err |= clSetKernelArg(_initShape, 5, sizeof(int), &flag);
+	err |= clSetKernelArg(_initShape, 6, sizeof(cl_mem), _arena.addr(_gravityRegion));
+	err |= clSetKernelArg(_initShape, 7, sizeof(cl_uint), &nGravityPoints);
+	err |= clSetKernelArg(_initShape, 8, sizeof(cl_uint), &h.speed);
+	err |= clSetKernelArg(_initShape, 9, sizeof(cl_uint), &h.seed);
+	if (err != CL_SUCCESS)
+		throw openClError("   \033[33mFailed to set kernel init arguments\033[0m");
+
+	cl_float4* hostPos = reinterpret_cast<cl_float4*>(st.file.data() + h.posOffset);
+	cl_float4* hostVel = reinterpret_cast<cl_float4*>(st.file.data() + h.velOffset);
+	cl_event downloaded[2] = {};		// last read back from each slot
+	for (size_t c = 0; c < st.nChunks; ++c) {
+		const int s = c % 2;
+		cl_uint first = static_cast<cl_uint>(c * STREAM_CHUNK);
+		size_t count = std::min<size_t>(STREAM_CHUNK, h.nbParticle - first);
+
+		err  = clSetKernelArg(_initShape, 0, sizeof(cl_mem), st.pos[s].addr());
+		err |= clSetKernelArg(_initShape, 1, sizeof(cl_mem), st.vel[s].addr());
+		err |= clSetKernelArg(_initShape, 2, sizeof(cl_mem), st.col[s].addr());
+		err |= clSetKernelArg(_initShape, 10, sizeof(cl_uint), &first);
+		if (err != CL_SUCCESS)
+			throw openClError("   \033[33mFailed to set kernel init arguments\033[0m");
+
+		// Chunk c - 2 must be on disk before its slot is overwritten
+		cl_event written;
+		size_t local = 128;
+		size_t global = ((count + local - 1) / local) * local;
+		err = clEnqueueNDRangeKernel(_clQueue, _initShape, 1, nullptr, &global, &local,
+			downloaded[s] ? 1 : 0, downloaded[s] ? &downloaded[s] : nullptr, &written);
+		if (err != CL_SUCCESS) throw openClError("Failed to enqueue kernel initShape");
+		clFlush(_clQueue);
+		if (downloaded[s]) clReleaseEvent(downloaded[s]);
+
+		err  = clEnqueueReadBuffer(st.io, st.pos[s], CL_FALSE, 0, count * sizeof(cl_float4), hostPos + first, 1, &written, nullptr);
+		err |= clEnqueueReadBuffer(st.io, st.vel[s], CL_FALSE, 0, count * sizeof(cl_float4), hostVel + first, 1, &written, &downloaded[s]);
+		clReleaseEvent(written);
+		if (err != CL_SUCCESS) throw openClError("Failed to read back a streamed chunk");
+		clFlush(st.io);
+	}
+	clFinish(st.io);
+	for (cl_event event : downloaded)
+		if (event) clReleaseEvent(event);
+	setKernel(shapeName(h.shape));
+}
+
+// One pass = one simulation step over every chunk, spread over as many frames as needed.
+// Inside a frame: upload of chunk c + 1 on io while the main queue runs chunk c,
+// then c is read back into the file and its decimated subset lands in the GL buffers.
+void ParticleSystem::streamStep(float dt) {
+	StreamState &st = *_stream;
+	StreamHeader &h = st.header;
+	if (st.next == 0) {
+		st.passDt    = dt;
+		st.passStart = now();
+		st.stride    = std::max<size_t>(1, (h.nbParticle + _nbParticle - 1) / _nbParticle);
+		st.nRendered = std::min<size_t>(_nbParticle, (h.nbParticle + st.stride - 1) / st.stride);
+	}
+	const double frameStart = now();
+	const size_t begin = st.next;
+	const size_t end   = std::min(st.nChunks, st.next + st.chunksPerFrame);
+
+	cl_int err;
+	cl_uint nGravityPoints = static_cast<cl_uint>(_GravityCenter.size());
+	err  = clSetKernelArg(_updateSys, 4, sizeof(float), &st.passDt);
+	err |= clSetKernelArg(_updateSys, 5, sizeof(float), &h.time);
+	err |= clSetKernelArg(_updateSys, 6, sizeof(cl_mem), _arena.addr(_gravityRegion));
+	err |= clSetKernelArg(_updateSys, 7, sizeof(cl_uint), &nGravityPoints);
+	err |= clSetKernelArg(_updateSys, 8, sizeof(cl_uint), &_colorMode);
+	err |= clSetKernelArg(_updateSys, 9, sizeof(float), &_speedScale);
+	err |= setVolumeArgs(h.time);
+
+	cl_uint stride = static_cast<cl_uint>(st.stride);
+	cl_uint nbRender = static_cast<cl_uint>(st.nRendered);
+	err |= clSetKernelArg(st.decimate, 4, sizeof(cl_uint), &stride);
+	err |= clSetKernelArg(st.decimate, 5, sizeof(cl_mem), _clPosBuffer.addr());
+	err |= clSetKernelArg(st.decimate, 6, sizeof(cl_mem), _clColBuffer.addr());
+	err |= clSetKernelArg(st.decimate, 7, sizeof(cl_uint), &nbRender);
+	if (err != CL_SUCCESS) throw openClError("Failed to set streaming kernel arguments");
+
+	cl_float4* hostPos = reinterpret_cast<cl_float4*>(st.file.data() + h.posOffset);
+	cl_float4* hostVel = reinterpret_cast<cl_float4*>(st.file.data() + h.velOffset);
+	auto chunkFirst = [&](size_t c) { return c * STREAM_CHUNK; };
+	auto chunkCount = [&](size_t c) { return std::min<size_t>(STREAM_CHUNK, h.nbParticle - chunkFirst(c)); };
+
+	// The slot of chunk c was last read back for c - 2, queued before on the in-order io queue
+	auto upload = [&](size_t c, cl_event *uploaded) {
+		const int s = c % 2;
+		size_t bytes = chunkCount(c) * sizeof(cl_float4);
+		cl_int e;
+		e  = clEnqueueWriteBuffer(st.io, st.pos[s], CL_FALSE, 0, bytes, hostPos + chunkFirst(c), 0, nullptr, nullptr);
+		e |= clEnqueueWriteBuffer(st.io, st.vel[s], CL_FALSE, 0, bytes, hostVel + chunkFirst(c), 0, nullptr, uploaded);
+		if (e != CL_SUCCESS) throw openClError("Failed to upload a streamed chunk");
+		clFlush(st.io);
+		if (c + 2 < st.nChunks) {
+			st.file.prefetch(h.posOffset + chunkFirst(c + 2) * sizeof(cl_float4), chunkCount(c + 2) * sizeof(cl_float4));
+			st.file.prefetch(h.velOffset + chunkFirst(c + 2) * sizeof(cl_float4), chunkCount(c + 2) * sizeof(cl_float4));
+		}
+	};
+
+	acquireGLObjects();
+	cl_event uploaded;
+	upload(begin, &uploaded);
+	for (size_t c = begin; c < end; ++c) {
+		const int s = c % 2;
+		cl_uint count = static_cast<cl_uint>(chunkCount(c));
+		cl_uint first = static_cast<cl_uint>(chunkFirst(c));
+
+		err  = clSetKernelArg(_updateSys, 0, sizeof(cl_mem), st.pos[s].addr());
+		err |= clSetKernelArg(_updateSys, 1, sizeof(cl_mem), st.vel[s].addr());
+		err |= clSetKernelArg(_updateSys, 2, sizeof(cl_mem), st.col[s].addr());
+		err |= clSetKernelArg(_updateSys, 3, sizeof(cl_uint), &count);
+		err |= clSetKernelArg(st.decimate, 0, sizeof(cl_mem), st.pos[s].addr());
+		err |= clSetKernelArg(st.decimate, 1, sizeof(cl_mem), st.col[s].addr());
+		err |= clSetKernelArg(st.decimate, 2, sizeof(cl_uint), &count);
+		err |= clSetKernelArg(st.decimate, 3, sizeof(cl_uint), &first);
+		if (err != CL_SUCCESS) throw openClError("Failed to set streaming kernel arguments");
+
+		size_t local = 128;
+		size_t global = ((count + local - 1) / local) * local;
+		err = clEnqueueNDRangeKernel(_clQueue, _updateSys, 1, nullptr, &global, &local, 1, &uploaded, nullptr);
+		clReleaseEvent(uploaded);
+		size_t picked = count / st.stride + 1;
+		size_t globalPicked = ((picked + local - 1) / local) * local;
+		cl_event computed;
+		err |= clEnqueueNDRangeKernel(_clQueue, st.decimate, 1, nullptr, &globalPicked, &local, 0, nullptr, &computed);
+		if (err != CL_SUCCESS) throw openClError("Failed to enqueue a streamed chunk");
+		clFlush(_clQueue);
+
+		// Overlaps the kernels above
+		if (c + 1 < end)
+			upload(c + 1, &uploaded);
+
+		size_t bytes = count * sizeof(cl_float4);
+		err  = clEnqueueReadBuffer(st.io, st.pos[s], CL_FALSE, 0, bytes, hostPos + first, 1, &computed, nullptr);
+		err |= clEnqueueReadBuffer(st.io, st.vel[s], CL_FALSE, 0, bytes, hostVel + first, 1, &computed, nullptr);
+		clReleaseEvent(computed);
+		if (err != CL_SUCCESS) throw openClError("Failed to read back a streamed chunk");
+		clFlush(st.io);
+	}
+	clFinish(st.io);
+	releaseGLObjects();
+	clFinish(_clQueue);
+
+	// Written back: out of our resident set, the page cache flushes them
+	const size_t evictFirst = chunkFirst(begin) * sizeof(cl_float4);
+	const size_t evictSize  = (chunkFirst(end - 1) + chunkCount(end - 1)) * sizeof(cl_float4) - evictFirst;
+	st.file.evict(h.posOffset + evictFirst, evictSize);
+	st.file.evict(h.velOffset + evictFirst, evictSize);
+
+	// Chunk budget follows the frame time
+	double ms = (now() - frameStart) * 1000.0;
+	if (ms < STREAM_FRAME_MS * 0.5)
+		st.chunksPerFrame++;
+	else if (ms > STREAM_FRAME_MS && st.chunksPerFrame > 1)
+		st.chunksPerFrame--;
+
+	st.next = end;
+	if (st.next == st.nChunks) {
+		st.next = 0;
+		h.steps++;
+		h.time += st.passDt;
+		_time = h.time;
+		st.lastPass = now() - st.passStart;
+		std::memcpy(st.file.data(), &h, sizeof(h));
+	}
+}
@@ -0,0 +1,123 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TrailRenderer.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 19:29:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 19:29:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+
+#include "TrailRenderer.hpp"
+#include "FrameUniforms.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static GLuint compileShader(GLenum type, const char* path) {
+	std::ifstream file(path);
+	if (!file.is_open())
+		throw openGlError(std::string("   \033[33mCannot open shader file: ") + path + "\033[0m");
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string code = buffer.str();
+	const char* src = code.c_str();
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+	GLint ok = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		glDeleteShader(shader);
+		throw openGlError(std::string("   \033[33m") + path + ": " + log + "\033[0m");
+	}
+	return shader;
+}
+
+// Constructeur
+TrailRenderer::TrailRenderer(): _program(0), _vao(0), _trailTex(0), _colorTex(0),
+	_lengthLoc(-1), _headLoc(-1), _strideLoc(-1), _alphaLoc(-1) {}
+
+TrailRenderer::~TrailRenderer() {
+	cleanup();
+}
+
+void TrailRenderer::init() {
+	GLuint vShader = compileShader(GL_VERTEX_SHADER, "shaders/trail_vertex.glsl");
+	GLuint fShader = compileShader(GL_FRAGMENT_SHADER, "shaders/trail_fragment.glsl");
+	_program = glCreateProgram();
+	glAttachShader(_program, vShader);
+	glAttachShader(_program, fShader);
+	glLinkProgram(_program);
+	glDeleteShader(vShader);
+	glDeleteShader(fShader);
+
+	GLint ok = 0;
+	glGetProgramiv(_program, GL_LINK_STATUS, &ok);
+	if (!ok)
+		throw openGlError("   \033[33mFailed to link the trail shaders\033[0m");
+
+	// Samplers never move, the camera comes from the Frame block
+	bindFrameBlock(_program);
+	glUseProgram(_program);
+	glUniform1i(glGetUniformLocation(_program, "uTrail"), 0);
+	glUniform1i(glGetUniformLocation(_program, "uColors"), 1);
+	_lengthLoc = glGetUniformLocation(_program, "uLength");
+	_headLoc   = glGetUniformLocation(_program, "uHead");
+	_strideLoc = glGetUniformLocation(_program, "uStride");
+	_alphaLoc  = glGetUniformLocation(_program, "uTrailAlpha");
+	glUseProgram(0);
+
+	glGenVertexArrays(1, &_vao);
+	glGenTextures(1, &_trailTex);
+	glGenTextures(1, &_colorTex);
+}
+
+void TrailRenderer::cleanup() {
+	if (_colorTex) glDeleteTextures(1, &_colorTex);
+	if (_trailTex) glDeleteTextures(1, &_trailTex);
+	if (_vao) glDeleteVertexArrays(1, &_vao);
+	if (_program) glDeleteProgram(_program);
+	_colorTex = _trailTex = _vao = _program = 0;
+}
+
+void TrailRenderer::render(const ParticleSystem &system, bool additive, float weight) {
+	const GLsizei count = system.trailsDrawn();
+	if (!_program || !system.trailsLive() || count == 0)
+		return;
+	const GLint length = system.getTrailLength();
+
+	glUseProgram(_program);
+	glUniform1i(_lengthLoc, length);
+	glUniform1i(_headLoc, static_cast<GLint>(system.getTrailHead()));
+	glUniform1i(_strideLoc, static_cast<GLint>(system.getTrailStride()));
+	glUniform1f(_alphaLoc, system.getTrailAlpha() * weight);
+
+	// The buffers move with a reallocation: attached again every frame, it costs nothing
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, _trailTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, system.trailBuffer());
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, _colorTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, system.colBuffer());
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(_vao);
+	glDrawArraysInstanced(GL_LINE_STRIP, 0, length, count);
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
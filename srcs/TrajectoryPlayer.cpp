@@ -0,0 +1,235 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TrajectoryPlayer.cpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 10:29:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 01:19:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Trajectory.hpp"
+#include "Parallel.hpp"
+
+#include <climits>
+#include <cstring>
+
+// LSB first bit reader, reads zeros past the end instead of faulting
+struct BitReader {
+	const uint8_t	*p;
+	const uint8_t	*end;
+	uint64_t		acc = 0;
+	unsigned		n = 0;
+
+	BitReader(const uint8_t *begin, const uint8_t *e) : p(begin), end(e) {}
+
+	void refill() {
+		while (n <= 56) {
+			acc |= static_cast<uint64_t>(p < end ? *p++ : 0) << n;
+			n += 8;
+		}
+	}
+	uint32_t get(unsigned count) {
+		if (n < count) refill();
+		uint32_t v = static_cast<uint32_t>(acc & ((1ull << count) - 1ull));
+		acc >>= count;
+		n -= count;
+		return v;
+	}
+	// Number of 1 before the terminating 0, capped to max (no terminator then)
+	unsigned unary(unsigned max) {
+		refill();
+		uint64_t zeros = ~acc;
+		unsigned q = zeros ? static_cast<unsigned>(__builtin_ctzll(zeros)) : 64u;
+		if (q >= max) {
+			get(max);
+			return max;
+		}
+		get(q + 1);
+		return q;
+	}
+};
+
+static inline int32_t unzigzag(uint32_t v) {
+	return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1u);
+}
+
+// Keyframe: q holds nothing useful, residuals chain along the particles
+// Delta frame: q holds the previous frame and is updated in place
+static void decodeChannel(BitReader &br, uint16_t *q, size_t n, bool keyframe) {
+	for (size_t b = 0; b < n; b += TRAJ_BLOCK) {
+		size_t count = std::min<size_t>(TRAJ_BLOCK, n - b);
+		unsigned k = br.get(5);
+		for (size_t i = 0; i < count; ++i) {
+			unsigned high = br.unary(TRAJ_ESCAPE);
+			uint32_t v = (high < TRAJ_ESCAPE) ? ((high << k) | br.get(k)) : br.get(TRAJ_RAW_BITS);
+			size_t id = b + i;
+			int32_t ref = keyframe ? (id ? q[id - 1] : 0) : q[id];
+			q[id] = static_cast<uint16_t>(ref + unzigzag(v));
+		}
+	}
+}
+
+// Constructeur
+TrajectoryPlayer::TrajectoryPlayer(): _decoded(SIZE_MAX), _frame(0), _clock(0.0f), _rate(1.0f),
+	_playing(false) {
+	std::memset(&_header, 0, sizeof(_header));
+}
+
+TrajectoryPlayer::~TrajectoryPlayer() {}
+
+// Only the header, footer and seek table are read, frames stay in the mapping
+void TrajectoryPlayer::open(const std::string &path, ParticleSystem &system) {
+	close();
+	_file.open(path);
+
+	const size_t size = _file.size();
+	if (size < sizeof(TrajectoryHeader) + sizeof(TrajectoryFooter))
+		throw fileError("   \033[33m" + path + " is not a trajectory\033[0m");
+
+	std::memcpy(&_header, _file.data(), sizeof(_header));
+	TrajectoryFooter footer;
+	std::memcpy(&footer, _file.data() + size - sizeof(footer), sizeof(footer));
+
+	if (std::memcmp(_header.magic, TRAJ_MAGIC, sizeof(_header.magic)) != 0
+		|| std::memcmp(footer.magic, TRAJ_INDEX_MAGIC, sizeof(footer.magic)) != 0) {
+		close();
+		throw fileError("   \033[33m" + path + " is not a complete trajectory\033[0m");
+	}
+	if (_header.version != TRAJ_VERSION || _header.headerSize != sizeof(TrajectoryHeader)
+		|| _header.chunkSize != TRAJ_CHUNK) {
+		close();
+		throw fileError("   \033[33mUnsupported trajectory version in " + path + "\033[0m");
+	}
+	if (footer.nFrames == 0 || _header.nbParticle == 0 || _header.nbParticle > INT_MAX
+		|| footer.indexOffset + footer.nFrames * sizeof(TrajectoryIndexEntry) + sizeof(footer) != size) {
+		close();
+		throw fileError("   \033[33mCorrupted trajectory " + path + "\033[0m");
+	}
+
+	const TrajectoryIndexEntry *index = reinterpret_cast<const TrajectoryIndexEntry*>(_file.data() + footer.indexOffset);
+	_index.assign(index, index + footer.nFrames);
+	for (auto &entry : _index) {
+		if (entry.offset + entry.size > footer.indexOffset) {
+			close();
+			throw fileError("   \033[33mCorrupted trajectory " + path + "\033[0m");
+		}
+	}
+	if (!_index[0].keyframe) {
+		close();
+		throw fileError("   \033[33mCorrupted trajectory " + path + "\033[0m");
+	}
+
+	for (int c = 0; c < 3; ++c)
+		_q[c].assign(_header.nbParticle, 0);
+	_decoded = SIZE_MAX;
+
+	if (system.getNPart() != _header.nbParticle)
+		system.setNbPart(static_cast<int>(_header.nbParticle));
+	seek(0, system);
+}
+
+void TrajectoryPlayer::close() {
+	_file.close();
+	_index.clear();
+	for (int c = 0; c < 3; ++c)
+		_q[c].clear();
+	_decoded = SIZE_MAX;
+	_frame = 0;
+	_clock = 0.0f;
+	_playing = false;
+}
+
+void TrajectoryPlayer::seek(size_t frame, ParticleSystem &system) {
+	if (_index.empty())
+		return;
+	if (system.getNPart() != _header.nbParticle) {
+		close();		// The buffers no longer hold the recording
+		return;
+	}
+	frame = std::min(frame, _index.size() - 1);
+
+	// Nearest keyframe, unless the frame already decoded is on the way
+	size_t key = frame;
+	while (key > 0 && !_index[key].keyframe) key--;
+	size_t from = (_decoded != SIZE_MAX && _decoded <= frame && _decoded >= key) ? _decoded + 1 : key;
+
+	for (size_t f = from; f <= frame; ++f)
+		decodeFrame(f);
+
+	_frame = frame;
+	_clock = _index[frame].time - _index[0].time;
+	upload(frame, system);
+}
+
+void TrajectoryPlayer::update(float dt, ParticleSystem &system) {
+	if (!_playing || _index.empty())
+		return;
+
+	_clock += dt * _rate;
+	float target = _index[0].time + _clock;
+	size_t frame = _frame;
+	while (frame + 1 < _index.size() && _index[frame + 1].time <= target) frame++;
+
+	if (frame + 1 >= _index.size())
+		_playing = false;	// end of the recording
+	if (frame != _frame) {
+		float clock = _clock;
+		seek(frame, system);
+		_clock = clock;
+	}
+}
+
+void TrajectoryPlayer::decodeFrame(size_t f) {
+	_decoded = SIZE_MAX;	// _q is garbage until this frame is complete
+	const TrajectoryIndexEntry &entry = _index[f];
+	const uint8_t *base = _file.data() + entry.offset;
+	const uint8_t *end  = base + entry.size;
+
+	TrajectoryFrameHeader frame;
+	std::memcpy(&frame, base, sizeof(frame));
+	const size_t n = _header.nbParticle;
+	const size_t nChunks = (n + TRAJ_CHUNK - 1) / TRAJ_CHUNK;
+	if (frame.nChunks != nChunks || sizeof(frame) + nChunks * sizeof(uint64_t) > entry.size)
+		throw fileError("   \033[33mCorrupted trajectory frame\033[0m");
+
+	const uint8_t *table = base + sizeof(frame);
+	const uint8_t *payload = table + nChunks * sizeof(uint64_t);
+
+	parallelFor(nChunks, [&](size_t chunk) {
+		uint64_t first = 0, last = 0;
+		if (chunk) std::memcpy(&first, table + (chunk - 1) * sizeof(uint64_t), sizeof(uint64_t));
+		std::memcpy(&last, table + chunk * sizeof(uint64_t), sizeof(uint64_t));
+		const uint8_t *stop = std::min(end, payload + last);
+
+		size_t begin = chunk * TRAJ_CHUNK;
+		size_t count = std::min<size_t>(TRAJ_CHUNK, n - begin);
+		BitReader br(payload + first, stop);
+		for (int c = 0; c < 3; ++c)
+			decodeChannel(br, _q[c].data() + begin, count, frame.keyframe != 0);
+	});
+	_decoded = f;
+}
+
+// Dequantize straight into the mapped VBO, updateSpace never runs
+void TrajectoryPlayer::upload(size_t f, ParticleSystem &system) {
+	TrajectoryFrameHeader frame;
+	std::memcpy(&frame, _file.data() + _index[f].offset, sizeof(frame));
+	const size_t n = _header.nbParticle;
+
+	cl_float4 *dst = system.mapPositions();
+
+	parallelFor((n + TRAJ_CHUNK - 1) / TRAJ_CHUNK, [&](size_t chunk) {
+		size_t begin = chunk * TRAJ_CHUNK;
+		size_t last  = std::min<size_t>(begin + TRAJ_CHUNK, n);
+		for (size_t i = begin; i < last; ++i) {
+			for (int c = 0; c < 3; ++c)
+				dst[i].s[c] = frame.gridMin[c] + _q[c][i] * frame.gridStep[c];
+			dst[i].s[3] = 1.0f;
+		}
+	});
+
+	system.unmapPositions();
+}
@@ -0,0 +1,295 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TrajectoryRecorder.cpp                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 10:24:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 10:24:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "Trajectory.hpp"
+#include "Parallel.hpp"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// LSB first bit packer
+struct BitWriter {
+	std::vector<uint8_t>	&out;
+	uint64_t				acc = 0;
+	unsigned				n = 0;
+
+	explicit BitWriter(std::vector<uint8_t> &o) : out(o) {}
+
+	void put(uint32_t bits, unsigned count) {
+		acc |= static_cast<uint64_t>(bits) << n;
+		n += count;
+		while (n >= 8) {
+			out.push_back(static_cast<uint8_t>(acc));
+			acc >>= 8;
+			n -= 8;
+		}
+	}
+	void flush() {
+		if (n) out.push_back(static_cast<uint8_t>(acc));
+		acc = 0;
+		n = 0;
+	}
+};
+
+static inline uint32_t zigzag(int32_t d) {
+	return (static_cast<uint32_t>(d) << 1) ^ static_cast<uint32_t>(d >> 31);
+}
+
+// Rice parameter close to log2 of the mean residual
+static unsigned riceParameter(const uint32_t *v, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < n; ++i) sum += v[i];
+	uint32_t mean = static_cast<uint32_t>(sum / n);
+	unsigned k = 0;
+	while (k < 16 && (mean >> (k + 1)) > 0) k++;
+	return k;
+}
+
+static void encodeChannel(BitWriter &bw, const uint16_t *q, const uint16_t *prev, size_t n) {
+	uint32_t v[TRAJ_BLOCK];
+
+	for (size_t b = 0; b < n; b += TRAJ_BLOCK) {
+		size_t count = std::min<size_t>(TRAJ_BLOCK, n - b);
+		for (size_t i = 0; i < count; ++i) {
+			size_t id = b + i;
+			int32_t ref = prev ? prev[id] : (id ? q[id - 1] : 0);
+			v[i] = zigzag(static_cast<int32_t>(q[id]) - ref);
+		}
+
+		unsigned k = riceParameter(v, count);
+		bw.put(k, 5);
+		for (size_t i = 0; i < count; ++i) {
+			uint32_t high = v[i] >> k;
+			if (high < TRAJ_ESCAPE) {
+				bw.put((1u << high) - 1u, high + 1);	// unary, terminated by a 0
+				bw.put(v[i] & ((1u << k) - 1u), k);
+			} else {
+				bw.put((1u << TRAJ_ESCAPE) - 1u, TRAJ_ESCAPE);
+				bw.put(v[i], TRAJ_RAW_BITS);
+			}
+		}
+	}
+}
+
+// Constructeur
+TrajectoryRecorder::TrajectoryRecorder(): _file(nullptr), _nbParticle(0), _stepInterval(1),
+	_keyInterval(32), _step(0), _stopping(false), _hasGrid(false), _sinceKey(0), _bytes(0),
+	_framesWritten(0), _dropped(0) {}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+	stop();
+}
+
+void TrajectoryRecorder::start(const std::string &path, size_t nbParticle, uint32_t stepInterval, uint32_t keyInterval) {
+	stop();
+
+	_file = std::fopen(path.c_str(), "wb");
+	if (!_file)
+		throw fileError("   \033[33mCannot create " + path + "\033[0m");
+
+	_nbParticle    = nbParticle;
+	_stepInterval  = std::max(1u, stepInterval);
+	_keyInterval   = std::max(1u, keyInterval);
+	_step          = 0;
+	_hasGrid       = false;
+	_sinceKey      = 0;
+	_framesWritten = 0;
+	_dropped       = 0;
+	_stopping      = false;
+	_index.clear();
+	for (int c = 0; c < 3; ++c) {
+		_q[c].assign(nbParticle, 0);
+		_prev[c].assign(nbParticle, 0);
+	}
+
+	TrajectoryHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, TRAJ_MAGIC, sizeof(header.magic));
+	header.version      = TRAJ_VERSION;
+	header.headerSize   = sizeof(TrajectoryHeader);
+	header.nbParticle   = nbParticle;
+	header.stepInterval = _stepInterval;
+	header.keyInterval  = _keyInterval;
+	header.chunkSize    = TRAJ_CHUNK;
+	std::fwrite(&header, sizeof(header), 1, _file);
+	_bytes = sizeof(header);
+
+	_writer = std::thread(&TrajectoryRecorder::writerLoop, this);
+}
+
+void TrajectoryRecorder::stop() {
+	if (!_file)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_cv.notify_one();
+	_writer.join();
+
+	// Seek table, then the footer that points at it
+	TrajectoryFooter footer;
+	std::memset(&footer, 0, sizeof(footer));
+	footer.indexOffset = _bytes;
+	footer.nFrames     = _index.size();
+	std::memcpy(footer.magic, TRAJ_INDEX_MAGIC, sizeof(footer.magic));
+	std::fwrite(_index.data(), sizeof(TrajectoryIndexEntry), _index.size(), _file);
+	std::fwrite(&footer, sizeof(footer), 1, _file);
+	std::fclose(_file);
+	_file = nullptr;
+
+	_pending.clear();
+	_free.clear();
+}
+
+void TrajectoryRecorder::onStep(ParticleSystem &system) {
+	if (!_file)
+		return;
+	if (system.getNPart() != _nbParticle) {
+		stop();		// The recording can not change size
+		return;
+	}
+	if (++_step % _stepInterval != 0)
+		return;
+
+	Capture capture;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_pending.size() >= 3) {
+			_dropped++;
+			return;
+		}
+		if (!_free.empty()) {
+			capture = std::move(_free.back());
+			_free.pop_back();
+		}
+	}
+	capture.pos.resize(_nbParticle);
+	capture.time = system.getTime();
+	capture.ready = system.readPositions(capture.pos.data());	// the step goes on, the writer waits
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending.push_back(std::move(capture));
+	}
+	_cv.notify_one();
+}
+
+void TrajectoryRecorder::writerLoop() {
+	for (;;) {
+		Capture capture;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this]() { return _stopping || !_pending.empty(); });
+			if (_pending.empty())
+				return;		// stopping, everything is flushed
+			capture = std::move(_pending.front());
+			_pending.pop_front();
+		}
+
+		if (capture.ready) {
+			clWaitForEvents(1, &capture.ready);
+			clReleaseEvent(capture.ready);
+			capture.ready = nullptr;
+		}
+		encodeFrame(capture);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_free.push_back(std::move(capture));
+	}
+}
+
+void TrajectoryRecorder::encodeFrame(const Capture &capture) {
+	const size_t n = _nbParticle;
+	const cl_float4 *pos = capture.pos.data();
+
+	float bmin[3] = { FLT_MAX,  FLT_MAX,  FLT_MAX};
+	float bmax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (size_t i = 0; i < n; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			bmin[c] = std::min(bmin[c], pos[i].s[c]);
+			bmax[c] = std::max(bmax[c], pos[i].s[c]);
+		}
+	}
+
+	bool inside = _hasGrid;
+	for (int c = 0; c < 3 && inside; ++c)
+		inside = bmin[c] >= _gridMin[c] && bmax[c] <= _gridMin[c] + _gridStep[c] * 65535.0f;
+
+	bool keyframe = !inside || _sinceKey >= _keyInterval;
+	if (keyframe) {
+		// A margin keeps the next frames inside the grid, so they can be deltas
+		for (int c = 0; c < 3; ++c) {
+			float margin = (bmax[c] - bmin[c]) * 0.25f + 1e-3f;
+			_gridMin[c]  = bmin[c] - margin;
+			_gridStep[c] = (bmax[c] - bmin[c] + 2.0f * margin) / 65535.0f;
+		}
+		_hasGrid = true;
+		_sinceKey = 0;
+	}
+
+	const size_t nChunks = (n + TRAJ_CHUNK - 1) / TRAJ_CHUNK;
+	std::vector<std::vector<uint8_t>> chunks(nChunks);
+
+	parallelFor(nChunks, [&](size_t chunk) {
+		size_t begin = chunk * TRAJ_CHUNK;
+		size_t count = std::min<size_t>(TRAJ_CHUNK, n - begin);
+
+		for (int c = 0; c < 3; ++c) {
+			float inv = 1.0f / _gridStep[c];
+			for (size_t i = begin; i < begin + count; ++i) {
+				float q = std::round((pos[i].s[c] - _gridMin[c]) * inv);
+				_q[c][i] = static_cast<uint16_t>(std::min(65535.0f, std::max(0.0f, q)));
+			}
+		}
+
+		BitWriter bw(chunks[chunk]);
+		for (int c = 0; c < 3; ++c)
+			encodeChannel(bw, _q[c].data() + begin, keyframe ? nullptr : _prev[c].data() + begin, count);
+		bw.flush();
+	});
+
+	TrajectoryFrameHeader frame;
+	frame.keyframe = keyframe ? 1u : 0u;
+	frame.nChunks  = static_cast<uint32_t>(nChunks);
+	for (int c = 0; c < 3; ++c) {
+		frame.gridMin[c]  = _gridMin[c];
+		frame.gridStep[c] = _gridStep[c];
+	}
+
+	std::vector<uint64_t> chunkEnd(nChunks);
+	uint64_t payload = 0;
+	for (size_t i = 0; i < nChunks; ++i) {
+		payload += chunks[i].size();
+		chunkEnd[i] = payload;
+	}
+
+	TrajectoryIndexEntry entry;
+	entry.offset   = _bytes;
+	entry.size     = sizeof(frame) + sizeof(uint64_t) * nChunks + payload;
+	entry.time     = capture.time;
+	entry.keyframe = frame.keyframe;
+
+	std::fwrite(&frame, sizeof(frame), 1, _file);
+	std::fwrite(chunkEnd.data(), sizeof(uint64_t), nChunks, _file);
+	for (auto &chunk : chunks)
+		std::fwrite(chunk.data(), 1, chunk.size(), _file);
+
+	_index.push_back(entry);
+	_bytes += entry.size;
+	_framesWritten++;
+	_sinceKey++;
+	for (int c = 0; c < 3; ++c)
+		_q[c].swap(_prev[c]);
+}
@@ -0,0 +1,130 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VectorField.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/19 22:34:37 by lde-merc          #+#    #+#             */
+/*   Updated: 2026/10/19 22:34:37 by lde-merc         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ParticleSystem.hpp"
+#include "VectorField.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// Next number of the mapped text: the mapping has no terminating zero, so the
+// token is copied before strtof reads it
+static bool nextNumber(const char* &p, const char* end, float &value) {
+	while (p < end && (std::isspace(static_cast<unsigned char>(*p)) || *p == ','))
+		++p;
+	char token[64];
+	size_t n = 0;
+	while (p < end && n < sizeof(token) - 1 && !std::isspace(static_cast<unsigned char>(*p)) && *p != ',')
+		token[n++] = *p++;
+	token[n] = '\0';
+	char* stop;
+	value = std::strtof(token, &stop);
+	return n && *stop == '\0';
+}
+
+static bool isFga(const std::string &path) {
+	if (path.size() < 4)
+		return false;
+	std::string ext = path.substr(path.size() - 4);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+	return ext == ".fga";
+}
+
+static void readFga(const std::string &path, const MappedFile &file, VectorField &field) {
+	const char* p = reinterpret_cast<const char*>(file.data());
+	const char* end = p + file.size();
+
+	float header[9];
+	for (float &v : header)
+		if (!nextNumber(p, end, v))
+			throw fileError("   \033[33m" + path + ": truncated FGA header\033[0m");
+	for (int i = 0; i < 3; ++i) {
+		if (header[i] < 1.0f || header[i] > VFIELD_MAX_SIZE)
+			throw fileError("   \033[33m" + path + ": unsupported FGA resolution\033[0m");
+		field.size[i] = static_cast<cl_uint>(header[i]);
+	}
+	field.bmin = glm::vec3(header[3], header[4], header[5]);
+	field.bmax = glm::vec3(header[6], header[7], header[8]);
+	if (glm::any(glm::lessThanEqual(field.bmax, field.bmin)))
+		throw fileError("   \033[33m" + path + ": empty FGA bounds\033[0m");
+
+	// Text: one pass in file order, the parse is the whole cost
+	field.texels.resize(static_cast<size_t>(field.size[0]) * field.size[1] * field.size[2]);
+	for (cl_float4 &t : field.texels) {
+		if (!nextNumber(p, end, t.s[0]) || !nextNumber(p, end, t.s[1]) || !nextNumber(p, end, t.s[2]))
+			throw fileError("   \033[33m" + path + ": truncated FGA data\033[0m");
+		t.s[3] = 0.0f;
+	}
+}
+
+static void readRaw(const std::string &path, const MappedFile &file, VectorField &field) {
+	const size_t vectors = file.size() / (3 * sizeof(float));
+	const size_t side = static_cast<size_t>(std::lround(std::cbrt(static_cast<double>(vectors))));
+	if (!vectors || file.size() % (3 * sizeof(float)) || side * side * side != vectors || side > VFIELD_MAX_SIZE)
+		throw fileError("   \033[33m" + path + " is not a cubic float32 xyz grid\033[0m");
+
+	field.size[0] = field.size[1] = field.size[2] = static_cast<cl_uint>(side);
+	field.bmax = glm::vec3(static_cast<float>(side) * 0.5f);
+	field.bmin = -field.bmax;
+
+	// xyz to xyzw straight from the mapping, pages faulted in by every worker
+	field.texels.resize(vectors);
+	const float* src = reinterpret_cast<const float*>(file.data());
+	cl_float4* dst = field.texels.data();
+	const size_t chunk = 65536;
+	parallelFor((vectors + chunk - 1) / chunk, [&](size_t c) {
+		const size_t last = std::min(vectors, (c + 1) * chunk);
+		for (size_t i = c * chunk; i < last; ++i) {
+			std::memcpy(dst[i].s, src + 3 * i, 3 * sizeof(float));
+			dst[i].s[3] = 0.0f;
+		}
+	});
+}
+
+void readVectorField(const std::string &path, VectorField &field) {
+	MappedFile file;
+	file.open(path);
+	if (isFga(path))
+		readFga(path, file, field);
+	else
+		readRaw(path, file, field);
+}
+
+// Replaces the previous field. The type 4 sources place it, scale and falloff apply to all
+void ParticleSystem::loadVectorField(const std::string &path) {
+	if (!_fieldImages)
+		throw fileError("   \033[33mVector fields need OpenCL image support\033[0m");
+	VectorField field;
+	readVectorField(path, field);
+
+	cl_image_format format = {CL_RGBA, CL_FLOAT};
+	cl_image_desc desc = {};
+	desc.image_type = CL_MEM_OBJECT_IMAGE3D;
+	desc.image_width = field.size[0];
+	desc.image_height = field.size[1];
+	desc.image_depth = field.size[2];
+
+	cl_int err;
+	_vfieldImage.reset(clCreateImage(_clContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, &format, &desc,
+		field.texels.data(), &err));
+	if (err != CL_SUCCESS)
+		throw openClError("   \033[33mFailed to create the vector field image\033[0m");
+	std::copy(field.size, field.size + 3, _vfieldSize);
+	_vfieldMin = field.bmin;
+	_vfieldMax = field.bmax;
+	_vfieldPath = path;
+}
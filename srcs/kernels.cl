@@ -17,7 +17,7 @@ float hash(uint x) {
 	return (float)x / (float)UINT_MAX;
 }
 
-void createSphere(float radius, __global float4* positions, size_t gid, uint n) {
+void createSphere(float radius, __global float4* position, size_t gid, uint n) {
 	// Fibonacci repartition on a sphere
 		float u = (float)gid + 0.5f;
 		float v = u / (float)n;
@@ -26,21 +26,18 @@ void createSphere(float radius, __global float4* positions, size_t gid, uint n)
 		float z = 1.0f - 2.0f * v;
 		float r = sqrt(1.0f - z * z);
 
-		positions[gid].x = radius * r * cos(theta);
-		positions[gid].y = radius * r * sin(theta);
-		positions[gid].z = radius * z;
-		positions[gid].w = 1.0f;
+		*position = (float4)(radius * r * cos(theta), radius * r * sin(theta), radius * z, 1.0f);
 }
 
-void createCube(float baseCube, __global float4* positions, size_t gid) {
-	float x = (hash(gid * 3u + 0u) * 2.0f - 1.0f) * baseCube / 2.0f;
-	float y = (hash(gid * 3u + 1u) * 2.0f - 1.0f) * baseCube / 2.0f ;
-	float z = (hash(gid * 3u + 2u) * 2.0f - 1.0f) * baseCube / 2.0f ;
+void createCube(float baseCube, __global float4* position, uint rid) {
+	float x = (hash(rid * 3u + 0u) * 2.0f - 1.0f) * baseCube / 2.0f;
+	float y = (hash(rid * 3u + 1u) * 2.0f - 1.0f) * baseCube / 2.0f ;
+	float z = (hash(rid * 3u + 2u) * 2.0f - 1.0f) * baseCube / 2.0f ;
 	
-	positions[gid] = (float4)(x, y, z, 1.0f);
+	*position = (float4)(x, y, z, 1.0f);
 }
 
-void createPyramid(__global float4* positions, size_t gid, const uint n, float baseSize) {
+void createPyramid(__global float4* position, size_t gid, const uint n, float baseSize) {
 	uint layers = 20;
 	float height = baseSize;
 
@@ -64,9 +61,81 @@ void createPyramid(__global float4* positions, size_t gid, const uint n, float b
 	float z = ((float)zId / (float)(side - 1) - 0.5f) * size;
 	float y = ((float)layer / (float)(layers - 1)) * height;
 
-	positions[gid] = (float4)(x, y, z, 1.0f);
+	*position = (float4)(x, y, z, 1.0f);
 }
 
+// Mesh shapes: the triangle comes from a binary search of the running area
+// table, then a uniform point inside it. Volume: the same search over the running
+// length of the inside spans (ray parity, see Mesh.hpp), then a uniform point in
+// the span's box. Any closed mesh, star-shaped or not
+void createMesh(float radius, __global float4* position, uint rid, __global const float* mesh,
+	__global const float* cdf, uint nTriangles, int volume) {
+	float u = hash(rid * 5u + 0u);
+	uint lo = 0, hi = nTriangles - 1;
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+		if (cdf[mid] < u) lo = mid + 1;
+		else hi = mid;
+	}
+
+	if (volume) {		// mesh holds the inside spans, x0 y0 x1 y1 z0 z1
+		float2 lo2 = vload2(3 * lo + 0, mesh);
+		float2 hi2 = vload2(3 * lo + 1, mesh);
+		float2 z = vload2(3 * lo + 2, mesh);
+		float3 p = (float3)(mix(lo2.x, hi2.x, hash(rid * 5u + 1u)), mix(lo2.y, hi2.y, hash(rid * 5u + 2u)),
+			mix(z.x, z.y, hash(rid * 5u + 3u)));
+		*position = (float4)(p * radius, 1.0f);
+		return;
+	}
+
+	float3 a = vload3(3 * lo + 0, mesh);
+	float3 b = vload3(3 * lo + 1, mesh);
+	float3 c = vload3(3 * lo + 2, mesh);
+	float r1 = sqrt(hash(rid * 5u + 1u));
+	float r2 = hash(rid * 5u + 2u);
+	float3 p = a * (1.0f - r1) + b * (r1 * (1.0f - r2)) + c * (r1 * r2);
+
+	*position = (float4)(p * radius, 1.0f);
+}
+
+// Image shapes: a row from the running luminance of the rows, a pixel from the
+// running luminance inside that row, then a uniform point in the pixel. Plane of
+// width 2 * radius in xy, top row up; relief raises it by the luminance. The
+// particle takes the pixel color. Only built when the host passes -D IMAGE_SHAPE
+#ifdef IMAGE_SHAPE
+#define PICTURE_RELIEF  0.5f        // height of a white pixel, in radius (mirror of Picture.hpp)
+
+__constant sampler_t pictureSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+uint searchCdf(__global const float* cdf, uint n, float u) {
+	uint lo = 0, hi = n - 1;
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+		if (cdf[mid] < u) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+void createImage(float radius, __global float4* position, __global float4* color, uint rid,
+	read_only image2d_t picture, __global const float* rowCdf, __global const float* pixelCdf,
+	uint width, uint height, int relief) {
+	uint y = searchCdf(rowCdf, height, hash(rid * 5u + 0u));
+	uint x = searchCdf(pixelCdf + (size_t)y * width, width, hash(rid * 5u + 1u));
+	float4 rgba = read_imagef(picture, pictureSampler, (int2)(x, y));
+
+	float scale = 2.0f * radius / (float)max(width, height);
+	float px = ((float)x + hash(rid * 5u + 2u) - 0.5f * (float)width) * scale;
+	float py = (0.5f * (float)height - (float)y - hash(rid * 5u + 3u)) * scale;
+	float pz = 0.0f;
+	if (relief)
+		pz = dot(rgba.xyz, (float3)(0.2126f, 0.7152f, 0.0722f)) * radius * PICTURE_RELIEF;
+
+	*position = (float4)(px, py, pz, 1.0f);
+	*color = (float4)(rgba.xyz, 1.0f);
+}
+#endif
+
 float3 getSurfaceNormal(float4 position, size_t gid, const uint nbParticles, const int shapeFlag) {
 	float3 normal = (float3)(0.0f, 0.0f, 0.0f);
 	
@@ -99,36 +168,42 @@ float3 getSurfaceNormal(float4 position, size_t gid, const uint nbParticles, con
 			float3 toCenter = -normalize((float3)(p.x, 0.0f, p.z));
 			normal = normalize((float3)(toCenter.x, 0.5f, toCenter.z));
 		}
+	} else if (shapeFlag >= 5) {
+		// Image : face au spectateur
+		normal = (float3)(0.0f, 0.0f, 1.0f);
+	} else {
+		// Mesh : centré sur l'origine, direction depuis le centre
+		normal = normalize(position.xyz);
 	}
 	
 	return normal;
 }
 
-void initSpeed(__global float4* positions, __global float4* velocities, size_t gid,
+void initSpeed(__global float4* position, __global float4* velocity, size_t gid,
 	__global const struct GravityPoint* gPoint, const uint nGravityPoint,
-	const uint nbParticles, const int shapeFlag, uint speed) {
+	const uint nbParticles, const int shapeFlag, uint speed, uint rid) {
 	
 	switch (speed) {
 		case 1: {
-			velocities[gid].xyz = (float3)(0.0f, 0.0f, 0.0f); break;
+			(*velocity).xyz = (float3)(0.0f, 0.0f, 0.0f); break;
 		}
 		case 2: {
 			// Obtenir la normale de surface
-			float3 normal = getSurfaceNormal(positions[gid], gid, nbParticles, shapeFlag);
+			float3 normal = getSurfaceNormal(*position, gid, nbParticles, shapeFlag);
 			
 			// Vitesse de base selon la normale
-			float baseSpeed = 1.0f + hash(gid) * 5.0f; // Vitesse entre 1 et 5
+			float baseSpeed = 1.0f + hash(rid) * 5.0f; // Vitesse entre 1 et 5
 			float3 normalVel = normal * baseSpeed;
 			
 			// Option 1 : Uniquement normale
-			// velocities[gid].xyz = normalVel;
+			// (*velocity).xyz = normalVel;
 			
 			// Option 2 : Normale + composante orbitale (mix)
 			float3 orbitalVel = (float3)(0.0f, 0.0f, 0.0f);
 			for(uint i = 0; i < nGravityPoint; i++) {
 				if (!gPoint[i].active) continue;
 				
-				float3 dir = gPoint[i]._Position.xyz - positions[gid].xyz;
+				float3 dir = gPoint[i]._Position.xyz - (*position).xyz;
 				float dist = length(dir);
 				if (dist < 0.2f) continue;
 				
@@ -140,7 +215,7 @@ void initSpeed(__global float4* positions, __global float4* velocities, size_t g
 				// 
 				// orbitalVel += tangent * orbitalSpeed;
 
-				float angle = hash(gid ^ (i * 2654435761u)) * 2.0f * PI;
+				float angle = hash(rid ^ (i * 2654435761u)) * 2.0f * PI;
 				float3 randAxis = normalize((float3)(
 					cos(angle),
 					sin(angle * 0.7f + 1.0f),
@@ -150,7 +225,7 @@ void initSpeed(__global float4* positions, __global float4* velocities, size_t g
 				
 				orbitalVel += tangent * orbitalSpeed;
 			}
-			velocities[gid].xyz = (normalVel * 0.7f + orbitalVel * 0.3f) * 0.8f;
+			(*velocity).xyz = (normalVel * 0.7f + orbitalVel * 0.3f) * 0.8f;
 			break;
 		}
 		case 3: {
@@ -159,7 +234,7 @@ void initSpeed(__global float4* positions, __global float4* velocities, size_t g
 			for(uint i = 0; i < nGravityPoint; i++) {
 				if (!gPoint[i].active) continue;
 				
-				float3 dir = gPoint[i]._Position.xyz - positions[gid].xyz;
+				float3 dir = gPoint[i]._Position.xyz - (*position).xyz;
 				float dist = length(dir);
 				
 				if (dist < 0.2f) continue;
@@ -168,8 +243,8 @@ void initSpeed(__global float4* positions, __global float4* velocities, size_t g
 				float orbitalSpeed = sqrt(gPoint[i]._Mass / dist);
 				
 				// Axe aléatoire pour la tangente
-				float angle1 = hash(gid * 2u ^ i) * 2.0f * PI;
-				float angle2 = hash(gid * 3u ^ i) * PI;
+				float angle1 = hash(rid * 2u ^ i) * 2.0f * PI;
+				float angle2 = hash(rid * 3u ^ i) * PI;
 				
 				float3 axis  = normalize((float3)(
 					sin(angle2) * cos(angle1),
@@ -180,15 +255,15 @@ void initSpeed(__global float4* positions, __global float4* velocities, size_t g
 				float3 tangent = normalize(cross(dirNorm, axis));
 				
 				// Excentricité légère pour orbites elliptiques (±20%)
-				float eccFactor = 0.85f + hash(gid * 5u ^ i) * 0.3f; // 0.85 à 1.15
+				float eccFactor = 0.85f + hash(rid * 5u ^ i) * 0.3f; // 0.85 à 1.15
 				
 				totalVel += tangent * orbitalSpeed * eccFactor;
 			}
-			velocities[gid].xyz = totalVel;
+			(*velocity).xyz = totalVel;
 			break ;
 		}
 		case 4: {
-			velocities[gid] = (float4)(3.0f, 0.0f, 0.0f, 0.0f);
+			*velocity = (float4)(3.0f, 0.0f, 0.0f, 0.0f);
 			break ;
 		}
 	}
@@ -202,20 +277,44 @@ __kernel void initShape(
 	const float radius, const int flag,
 	__global const struct GravityPoint* gPoint,
 	const uint nGravityPoint,
-	const uint speed)
+	const uint speed,
+	const uint seed,
+	const uint first,		// index of element 0 of the buffers, streamed chunks start further
+	__global const float* mesh,			// mesh shapes: 9 floats per triangle
+	__global const float* meshCdf,		// running area (3) or volume (4), normalized
+	const uint nTriangles
+#ifdef IMAGE_SHAPE
+	, read_only image2d_t picture,		// image shapes: RGBA8, top row first
+	__global const float* rowCdf,		// running luminance of the rows, normalized
+	__global const float* pixelCdf,		// running luminance inside each row, normalized
+	const uint width, const uint height
+#endif
+	)
 {
-	size_t gid = get_global_id(0);
+	size_t slot = get_global_id(0);
+	size_t gid = first + slot;
 	if (gid >= nbParticles) return;
 
+	// Random stream of this particle: seed 0 gives back the historical layout
+	uint rid = (uint)gid + seed * 2654435761u;
+	colors[slot] = (float4)(1.0f, 1.0f, 1.0f, 1.0f);	// kept by the image color mode
+
 	if (flag == 0) { // Sphere
-		createSphere(radius, positions, gid, nbParticles);
+		createSphere(radius, positions + slot, gid, nbParticles);
 	} else if (flag == 1) { // Cube
-		createCube(radius, positions, gid);
+		createCube(radius, positions + slot, rid);
 	} else if (flag == 2) { // Pyramide
-		createPyramid(positions, gid, nbParticles, radius);
+		createPyramid(positions + slot, gid, nbParticles, radius);
+	} else if (flag == 3 || flag == 4) { // Mesh
+		createMesh(radius, positions + slot, rid, mesh, meshCdf, nTriangles, flag == 4);
+	}
+#ifdef IMAGE_SHAPE
+	else if (flag == 5 || flag == 6) { // Image
+		createImage(radius, positions + slot, colors + slot, rid, picture, rowCdf, pixelCdf, width, height, flag == 6);
 	}
+#endif
 	
-	initSpeed(positions, velocities, gid, gPoint, nGravityPoint, nbParticles, flag, speed);
+	initSpeed(positions + slot, velocities + slot, gid, gPoint, nGravityPoint, nbParticles, flag, speed, rid);
 }
 
 // Curl noise helper
@@ -229,6 +328,165 @@ float3 curlNoise(float3 p, float t) {
 	return curl;
 }
 
+// Baked turbulence: curl of a tileable value noise potential, one volume per seed.
+// A curl has no divergence, nor has any blend of two curls: the flow neither
+// gathers nor empties. Only built when the host passes -D NOISE_VOLUME
+#define NOISE_CELLS     4           // lattice cells per tile, first octave
+#define NOISE_OCTAVES   4
+#define NOISE_TILE      16.0f       // world units per tile, at the scale of curlNoise
+#define NOISE_GAIN      1.5f
+
+// Lattice wrapped on the period: the volume tiles without a seam
+float latticeValue(int3 c, int period, uint seed) {
+	c = ((c % period) + period) % period;
+	return hash(seed * 0x9e3779b9u ^ (uint)(c.x + period * (c.y + period * c.z))) * 2.0f - 1.0f;
+}
+
+float periodicNoise(float3 p, int period, uint seed) {
+	float3 cell = floor(p);
+	float3 t    = p - cell;
+	int3   c    = convert_int3(cell);
+	t = t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);		// quintic, smooth derivative
+
+	float x00 = mix(latticeValue(c, period, seed), latticeValue(c + (int3)(1, 0, 0), period, seed), t.x);
+	float x10 = mix(latticeValue(c + (int3)(0, 1, 0), period, seed), latticeValue(c + (int3)(1, 1, 0), period, seed), t.x);
+	float x01 = mix(latticeValue(c + (int3)(0, 0, 1), period, seed), latticeValue(c + (int3)(1, 0, 1), period, seed), t.x);
+	float x11 = mix(latticeValue(c + (int3)(0, 1, 1), period, seed), latticeValue(c + (int3)(1, 1, 1), period, seed), t.x);
+	return mix(mix(x00, x10, t.y), mix(x01, x11, t.y), t.z);
+}
+
+// Vector potential at u in tile units, each octave scaled down by its frequency
+// so that its curl weighs half the previous one
+float3 noisePotential(float3 u, uint seed) {
+	float3 psi = (float3)(0.0f);
+	float  amp = 1.0f;
+	for (int o = 0; o < NOISE_OCTAVES; o++) {
+		int    period = NOISE_CELLS << o;
+		float3 p      = u * (float)period;
+		uint   s      = seed + (uint)o * 3u;
+		psi += (float3)(periodicNoise(p, period, s), periodicNoise(p, period, s + 1u),
+			periodicNoise(p, period, s + 2u)) * amp / (float)period;
+		amp *= 0.5f;
+	}
+	return psi;
+}
+
+// One texel per work-item, at its center. Copied into an image3d_t by the host
+__kernel void bakeCurlNoise(
+	__global float4* field,
+	const uint size,
+	const uint seed
+)
+{
+	size_t gid = get_global_id(0);
+	if (gid >= (size_t)size * size * size) return;
+
+	float3 texel = (float3)((float)(gid % size), (float)((gid / size) % size), (float)(gid / ((size_t)size * size)));
+	float3 u = (texel + 0.5f) / (float)size;
+	float  h = 0.25f / (float)size;
+	float3 dx = (float3)(h, 0.0f, 0.0f);
+	float3 dy = (float3)(0.0f, h, 0.0f);
+	float3 dz = (float3)(0.0f, 0.0f, h);
+
+	float3 ddx = noisePotential(u + dx, seed) - noisePotential(u - dx, seed);
+	float3 ddy = noisePotential(u + dy, seed) - noisePotential(u - dy, seed);
+	float3 ddz = noisePotential(u + dz, seed) - noisePotential(u - dz, seed);
+	float3 curl = (float3)(ddy.z - ddz.y, ddz.x - ddx.z, ddx.y - ddy.x) / (2.0f * h);
+	field[gid] = (float4)(curl * NOISE_GAIN, 0.0f);
+}
+
+#ifdef NOISE_VOLUME
+__constant sampler_t noiseSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_REPEAT | CLK_FILTER_LINEAR;
+#endif
+
+#define SOFTENING       0.2f
+#define MAX_SPEED       15.0f
+#define CAPTURE_RADIUS  0.5f
+
+// Gravity (0) and repulsion (3) only depend on the position: what updateSpace
+// sums for them, and what the force field bakes
+float3 staticForce(struct GravityPoint g, float3 pos) {
+	float3 dir = g._Position.xyz - pos;
+	if (g.type == 0) {
+		float dist2    = dot(dir, dir) + 0.01f; // epsilon
+		float invDist  = rsqrt(dist2);
+		float invDist3 = invDist * invDist * invDist;
+		return g._Mass * dir * invDist3;
+	}
+	float dist2    = dot(dir, dir) + SOFTENING * SOFTENING;
+	float invDist  = rsqrt(dist2);
+	float invDist3 = invDist * invDist * invDist;
+	return -g._Mass * dir * invDist3;
+}
+
+// Baked force field: xyz the summed static force, w the distance to the closest
+// static source (capture). A source closer than CAPTURE_RADIUS adds nothing, as in updateSpace
+#define FIELD_SIZE      64
+#define FIELD_FAR       1e30f
+
+float4 staticField(float3 pos, __global const struct GravityPoint* gPoint, const uint nGravityPoint) {
+	float4 field = (float4)(0.0f, 0.0f, 0.0f, FIELD_FAR);
+	for (uint i = 0; i < nGravityPoint; i++) {
+		if (!gPoint[i].active || (gPoint[i].type != 0 && gPoint[i].type != 3)) continue;
+		float dist = length(gPoint[i]._Position.xyz - pos);
+		field.w = min(field.w, dist);
+		if (dist >= CAPTURE_RADIUS)
+			field.xyz += staticForce(gPoint[i], pos);
+	}
+	return field;
+}
+
+// Texel i of an axis sits at boxMin + i * cell
+__kernel void bakeForceField(
+	__global float4* field,
+	const float4 boxMin,
+	const float4 cell,
+	__global const struct GravityPoint* gPoint,
+	const uint nGravityPoint
+)
+{
+	size_t gid = get_global_id(0);
+	if (gid >= FIELD_SIZE * FIELD_SIZE * FIELD_SIZE) return;
+
+	float3 texel = (float3)((float)(gid % FIELD_SIZE), (float)((gid / FIELD_SIZE) % FIELD_SIZE),
+		(float)(gid / (FIELD_SIZE * FIELD_SIZE)));
+	field[gid] = staticField(boxMin.xyz + texel * cell.xyz, gPoint, nGravityPoint);
+}
+
+#ifdef VECTOR_FIELD
+// Nothing outside the box of the imported field
+__constant sampler_t vfieldSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP | CLK_FILTER_LINEAR;
+#endif
+
+#ifdef FORCE_FIELD
+__constant sampler_t fieldSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+
+// Relative error of the trilinear fetch at the center of every cell, where it is the
+// farthest from the texels. -1 within two cells of a source: the host skips those
+__kernel void fieldError(
+	__read_only image3d_t field,
+	const float4 boxMin,
+	const float4 cell,
+	__global const struct GravityPoint* gPoint,
+	const uint nGravityPoint,
+	__global float* error
+)
+{
+	const uint cells = FIELD_SIZE - 1;
+	size_t gid = get_global_id(0);
+	if (gid >= cells * cells * cells) return;
+
+	float3 texel = (float3)((float)(gid % cells), (float)((gid / cells) % cells), (float)(gid / (cells * cells)));
+	float4 exact = staticField(boxMin.xyz + (texel + 0.5f) * cell.xyz, gPoint, nGravityPoint);
+	if (exact.w < 2.0f * length(cell.xyz)) {
+		error[gid] = -1.0f;
+		return;
+	}
+	float4 fetched = read_imagef(field, fieldSampler, (float4)((texel + 1.0f) / (float)FIELD_SIZE, 0.0f));
+	error[gid] = length(fetched.xyz - exact.xyz) / fmax(length(exact.xyz), 1e-6f);
+}
+#endif
+
 // Force in space
 __kernel void updateSpace(
 	__global float4* positions,
@@ -239,7 +497,31 @@ __kernel void updateSpace(
 	const float time,
 	__global const struct GravityPoint* gPoint,
 	const uint nGravityPoint,
-	const uint colorMode
+	const uint colorMode,
+	const float speedScale
+#ifdef NOISE_VOLUME
+	,
+	__read_only image3d_t noiseA,
+	__read_only image3d_t noiseB,
+	const float noiseBlend,
+	const float noiseScroll,
+	const int noiseBaked
+#endif
+#ifdef FORCE_FIELD
+	,
+	__read_only image3d_t field,
+	const float4 fieldScale,		// position to normalized coordinates
+	const float4 fieldOffset,
+	const int fieldBaked
+#endif
+#ifdef VECTOR_FIELD
+	,
+	__read_only image3d_t vfield,
+	const float4 vfieldMin,			// box of the texels around the source, world units
+	const float4 vfieldInvSize,
+	const float vfieldFalloff,
+	const int vfieldLoaded
+#endif
 )
 {
 	size_t gid = get_global_id(0);
@@ -249,12 +531,25 @@ __kernel void updateSpace(
 	float3 vel        = velocities[gid].xyz;
 	float3 totalForce = (float3)(0.0f, 0.0f, 0.0f);
 
-	#define SOFTENING       0.2f
-	#define MAX_SPEED       15.0f
-	#define CAPTURE_RADIUS  0.5f
+	// Inside the baked box, one fetch replaces every static source
+	bool inField = false;
+#ifdef FORCE_FIELD
+	if (fieldBaked) {
+		float3 uvw = pos * fieldScale.xyz + fieldOffset.xyz;
+		const float edge = 0.5f / FIELD_SIZE;
+		inField = all(uvw >= edge) && all(uvw <= 1.0f - edge);
+		if (inField) {
+			float4 f = read_imagef(field, fieldSampler, (float4)(uvw, 0.0f));
+			totalForce += f.xyz;
+			if (f.w < CAPTURE_RADIUS)
+				vel *= 0.80f;
+		}
+	}
+#endif
 
 	for (uint i = 0; i < nGravityPoint; i++) {
 		if (!gPoint[i].active) continue;
+		if (inField && (gPoint[i].type == 0 || gPoint[i].type == 3)) continue;
 
 		float3 dir  = gPoint[i]._Position.xyz - pos;
 		float  dist = length(dir);
@@ -274,10 +569,7 @@ __kernel void updateSpace(
 			// float invDist3 = invDist * invDist * invDist;
 			// totalForce    += gPoint[i]._Mass * dirNorm * invDist3;
 
-			float dist2    = dot(dir, dir) + 0.01f; // epsilon
-			float invDist  = rsqrt(dist2);
-			float invDist3 = invDist * invDist * invDist;
-			totalForce    += gPoint[i]._Mass * dir * invDist3;
+			totalForce += staticForce(gPoint[i], pos);
 
 		} else if (gPoint[i].type == 1) {
 			// Lorentz : champ magnétique centré sur le point
@@ -291,7 +583,17 @@ __kernel void updateSpace(
 		} else if (gPoint[i].type == 2) {
 			// Turbulence / Curl noise centré sur le point
 			float3 localPos = (pos - gPoint[i]._Position.xyz) * 0.5f;
+#ifdef NOISE_VOLUME
+			float3 curl;
+			if (noiseBaked) {
+				// Two trilinear fetches instead of twelve sin/cos
+				float4 uvw = (float4)(localPos / NOISE_TILE + noiseScroll, 0.0f);
+				curl = mix(read_imagef(noiseA, noiseSampler, uvw), read_imagef(noiseB, noiseSampler, uvw), noiseBlend).xyz;
+			} else
+				curl = curlNoise(localPos, time);
+#else
 			float3 curl     = curlNoise(localPos, time);
+#endif
 			float  falloff  = gPoint[i]._Mass / (dist + 1.0f); // Diminue avec la distance
 			totalForce     += curl * falloff;
 
@@ -301,10 +603,18 @@ __kernel void updateSpace(
 				vel *= 0.80f;
 				continue;
 			}
-			float dist2    = dist * dist + SOFTENING * SOFTENING;
-			float invDist  = rsqrt(dist2);
-			float invDist3 = invDist * invDist * invDist;
-			totalForce    -= gPoint[i]._Mass * dirNorm * dist * invDist3;
+			totalForce += staticForce(gPoint[i], pos);
+
+		} else if (gPoint[i].type == 4) {
+			// Champ de vecteurs importé, placé sur le point
+#ifdef VECTOR_FIELD
+			if (vfieldLoaded) {
+				float3 uvw  = (pos - gPoint[i]._Position.xyz - vfieldMin.xyz) * vfieldInvSize.xyz;
+				float3 flow = read_imagef(vfield, vfieldSampler, (float4)(uvw, 0.0f)).xyz;
+				float  fade = vfieldFalloff > 0.0f ? clamp(1.0f - dist / vfieldFalloff, 0.0f, 1.0f) : 1.0f;
+				totalForce += flow * gPoint[i]._Mass * fade;
+			}
+#endif
 		}
 	}
 
@@ -319,7 +629,7 @@ __kernel void updateSpace(
 	switch (colorMode) {
 		case 0: {
 			float speed = length(vel);
-			float speedNorm = clamp(speed / 7.0f, 0.0f, 1.0f);
+			float speedNorm = clamp(speed / speedScale, 0.0f, 1.0f);
 			speedNorm = speedNorm * speedNorm;  // Courbe quadratique
 
 			float3 coldColor = (float3)(0.3f, 0.0f, 0.8f);   // Violet foncé
@@ -338,7 +648,7 @@ __kernel void updateSpace(
 		}
 		case 1: {
 			float speed = length(vel);
-			float speedNorm = clamp(speed / 8.0f, 0.0f, 1.0f);
+			float speedNorm = clamp(speed / (speedScale * 8.0f / 7.0f), 0.0f, 1.0f);
 			speedNorm = 1.0f - exp(-speedNorm * 3.0f);  // Courbe exponentielle inversée
 
 			// Bleu profond → Bleu clair → Blanc → Jaune → Rouge
@@ -373,9 +683,355 @@ __kernel void updateSpace(
 			}
 			break;
 		}
-
+		case 3:		// image shapes and point clouds: the colors they were loaded with
+			color = colors[gid].xyz;
+			break;
 	}
 	colors[gid].xyz = color;
 	positions[gid].xyz = pos;
 	velocities[gid].xyz = vel;
 }
+
+// Live statistics, see SimStats in ParticleSystem.hpp
+// Fixed number of work-groups, each one loops over a strided range and writes
+// one StatsPartial: the host only reads STATS_GROUPS records, never N particles
+#define STATS_WG        128
+#define STATS_BINS      32
+#define STATS_MAX_GP    8
+
+struct StatsPartial {
+	float bmin[4];
+	float bmax[4];
+	float sum[4];       // xyz: sum of positions, w: sum of |p|^2
+	float kinetic;
+	float potential;
+	float maxSpeed;
+	float count;
+	uint  hist[STATS_BINS];
+	uint  captured[STATS_MAX_GP];
+};
+
+__kernel __attribute__((reqd_work_group_size(STATS_WG, 1, 1)))
+void reduceStats(
+	__global const float4* positions,
+	__global const float4* velocities,
+	const uint nbParticles,
+	__global const struct GravityPoint* gPoint,
+	const uint nGravityPoint,
+	const float maxSpeed,
+	__global struct StatsPartial* partials)
+{
+	__local float4 lmin[STATS_WG];
+	__local float4 lmax[STATS_WG];
+	__local float4 lsum[STATS_WG];
+	__local float4 lmisc[STATS_WG];     // kinetic, potential, max speed, count
+	__local uint   lhist[STATS_BINS];
+	__local uint   lcap[STATS_MAX_GP];
+
+	uint lid = get_local_id(0);
+	if (lid < STATS_BINS)   lhist[lid] = 0;
+	if (lid < STATS_MAX_GP) lcap[lid] = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	float3 bmin = (float3)(INFINITY);
+	float3 bmax = (float3)(-INFINITY);
+	float4 sum  = (float4)(0.0f);
+	float4 misc = (float4)(0.0f);
+	uint nGp = min(nGravityPoint, (uint)STATS_MAX_GP);
+
+	for (uint i = get_global_id(0); i < nbParticles; i += get_global_size(0)) {
+		float3 pos = positions[i].xyz;
+		float3 vel = velocities[i].xyz;
+		float speed2 = dot(vel, vel);
+		float speed  = sqrt(speed2);
+
+		bmin = fmin(bmin, pos);
+		bmax = fmax(bmax, pos);
+		sum += (float4)(pos, dot(pos, pos));
+		misc.x += 0.5f * speed2;
+		misc.z  = fmax(misc.z, speed);
+		misc.w += 1.0f;
+
+		uint bin = min((uint)(speed / maxSpeed * STATS_BINS), (uint)(STATS_BINS - 1));
+		atomic_inc(&lhist[bin]);
+
+		for (uint g = 0; g < nGp; g++) {
+			if (!gPoint[g].active) continue;
+			float dist = length(gPoint[g]._Position.xyz - pos);
+			if (dist < CAPTURE_RADIUS) atomic_inc(&lcap[g]);
+			if (gPoint[g].type == 0) misc.y -= gPoint[g]._Mass * rsqrt(dist * dist + 0.01f);
+		}
+	}
+
+	lmin[lid] = (float4)(bmin, 0.0f);
+	lmax[lid] = (float4)(bmax, 0.0f);
+	lsum[lid] = sum;
+	lmisc[lid] = misc;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint stride = STATS_WG / 2; stride > 0; stride >>= 1) {
+		if (lid < stride) {
+			lmin[lid] = fmin(lmin[lid], lmin[lid + stride]);
+			lmax[lid] = fmax(lmax[lid], lmax[lid + stride]);
+			lsum[lid] += lsum[lid + stride];
+			float4 o = lmisc[lid + stride];
+			lmisc[lid] = (float4)(lmisc[lid].x + o.x, lmisc[lid].y + o.y,
+				fmax(lmisc[lid].z, o.z), lmisc[lid].w + o.w);
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	__global struct StatsPartial* out = &partials[get_group_id(0)];
+	if (lid < STATS_BINS)   out->hist[lid] = lhist[lid];
+	if (lid < STATS_MAX_GP) out->captured[lid] = lcap[lid];
+	if (lid == 0) {
+		vstore4(lmin[0], 0, out->bmin);
+		vstore4(lmax[0], 0, out->bmax);
+		vstore4(lsum[0], 0, out->sum);
+		out->kinetic   = lmisc[0].x;
+		out->potential = lmisc[0].y;
+		out->maxSpeed  = lmisc[0].z;
+		out->count     = lmisc[0].w;
+	}
+}
+
+// Streaming: the particles of a chunk whose index is a multiple of stride
+// land in the rendered buffers, at index / stride
+__kernel void decimate(
+	__global const float4* positions,
+	__global const float4* colors,
+	const uint count,
+	const uint first,
+	const uint stride,
+	__global float4* renderPos,
+	__global float4* renderCol,
+	const uint nbRender)
+{
+	uint r = (first + stride - 1) / stride + (uint)get_global_id(0);
+	uint gid = r * stride;
+	if (gid >= first + count || r >= nbRender) return;
+
+	renderPos[r] = positions[gid - first];
+	renderCol[r] = colors[gid - first];
+}
+
+#define CULL_WG         128
+
+// Van der Corput radical inverse: the indices below a threshold form nested,
+// evenly spread subsets (every 2^k-th particle for a threshold of 1/2^k)
+float radicalInverse(uint i) {
+	i = (i << 16) | (i >> 16);
+	i = ((i & 0x00FF00FFu) << 8) | ((i & 0xFF00FF00u) >> 8);
+	i = ((i & 0x0F0F0F0Fu) << 4) | ((i & 0xF0F0F0F0u) >> 4);
+	i = ((i & 0x33333333u) << 2) | ((i & 0xCCCCCCCCu) >> 2);
+	i = ((i & 0x55555555u) << 1) | ((i & 0xAAAAAAAAu) >> 1);
+	return (float)i * 2.3283064365386963e-10f;
+}
+
+// Frustum culling: the planes come from the rows of the MVP (Gribb-Hartmann),
+// a point is drawn when it is on the inner side of all six (null planes keep
+// everything) and in the level of detail subset. Each work-group
+// packs its visible indices in local memory, then reserves its slice of the
+// index list with one atomic on the count of the indirect draw command.
+__kernel __attribute__((reqd_work_group_size(CULL_WG, 1, 1)))
+void cullFrustum(
+	__global const float4* positions,
+	const uint nbParticles,
+	const float4 left,
+	const float4 right,
+	const float4 bottom,
+	const float4 top,
+	const float4 zNear,
+	const float4 zFar,
+	__global uint* indices,
+	__global uint* command,		// DrawElementsIndirectCommand, count first
+	const float lod)			// fraction of the particles kept
+{
+	__local uint lidx[CULL_WG];
+	__local uint lcount;
+	__local uint base;
+
+	uint gid = get_global_id(0);
+	uint lid = get_local_id(0);
+	if (lid == 0) lcount = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (gid < nbParticles && (lod >= 1.0f || radicalInverse(gid) < lod)) {
+		float4 p = positions[gid];
+		if (dot(left, p) >= 0.0f && dot(right, p) >= 0.0f
+			&& dot(bottom, p) >= 0.0f && dot(top, p) >= 0.0f
+			&& dot(zNear, p) >= 0.0f && dot(zFar, p) >= 0.0f)
+			lidx[atomic_inc(&lcount)] = gid;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (lid == 0 && lcount > 0) base = atomic_add(&command[0], lcount);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if (lid < lcount) indices[base + lid] = lidx[lid];
+}
+
+// Depth sort of the visible indices, least significant digit radix sort.
+// Every pass: per-group digit counts, one scan of them, stable scatter.
+// The count comes from the indirect command, the host only knows a bound.
+#define SORT_WG         128
+#define SORT_ITEMS      16          // consecutive elements per work-item
+#define SORT_RADIX      16          // 4 bits per pass
+
+// Exclusive prefix of value over the work-group
+uint scanGroup(__local uint* partial, uint value) {
+	uint lid = get_local_id(0);
+	partial[lid] = value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	for (uint offset = 1; offset < SORT_WG; offset <<= 1) {
+		uint v = lid >= offset ? partial[lid - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		partial[lid] += v;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+	uint prefix = partial[lid] - value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+	return prefix;
+}
+
+// counts[d * SORT_WG + t]: elements of digit d among the ones of work-item t
+void countDigits(__global const uint* keys, uint n, uint shift, __local uint* counts) {
+	uint lid = get_local_id(0);
+	uint base = (get_group_id(0) * SORT_WG + lid) * SORT_ITEMS;
+	for (uint d = 0; d < SORT_RADIX; d++)
+		counts[d * SORT_WG + lid] = 0;
+	for (uint k = 0; k < SORT_ITEMS && base + k < n; k++)
+		counts[((keys[base + k] >> shift) & (SORT_RADIX - 1)) * SORT_WG + lid]++;
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// Back to front is ascending: the key grows toward the camera
+__kernel void sortKeys(
+	__global const float4* positions,
+	__global const uint* indices,
+	__global const uint* command,
+	const float4 depthRow,			// w row of the MVP: view depth
+	const float wNear,
+	const float wFar,
+	const uint bits,
+	__global uint* keys,
+	__global uint* values)
+{
+	uint i = get_global_id(0);
+	if (i >= command[0]) return;
+
+	uint id = indices[i];
+	float t = clamp((wFar - dot(depthRow, positions[id])) / (wFar - wNear), 0.0f, 1.0f);
+	keys[i] = (uint)(t * (float)((1u << bits) - 1u));
+	values[i] = id;
+}
+
+// hist[d * groups + g]: elements of digit d in the block of group g
+__kernel __attribute__((reqd_work_group_size(SORT_WG, 1, 1)))
+void radixHistogram(
+	__global const uint* keys,
+	__global const uint* command,
+	const uint shift,
+	__global uint* hist)
+{
+	__local uint counts[SORT_RADIX * SORT_WG];
+	countDigits(keys, command[0], shift, counts);
+
+	uint lid = get_local_id(0);
+	if (lid < SORT_RADIX) {
+		uint total = 0;
+		for (uint t = 0; t < SORT_WG; t++)
+			total += counts[lid * SORT_WG + t];
+		hist[lid * get_num_groups(0) + get_group_id(0)] = total;
+	}
+}
+
+// One work-group, exclusive scan in place: hist becomes the first
+// destination of every (digit, group)
+__kernel __attribute__((reqd_work_group_size(SORT_WG, 1, 1)))
+void radixScan(__global uint* hist, const uint total) {
+	__local uint partial[SORT_WG];
+
+	uint per = (total + SORT_WG - 1) / SORT_WG;
+	uint begin = min(get_local_id(0) * per, total);
+	uint end = min(begin + per, total);
+	uint sum = 0;
+	for (uint i = begin; i < end; i++)
+		sum += hist[i];
+
+	uint run = scanGroup(partial, sum);
+	for (uint i = begin; i < end; i++) {
+		uint c = hist[i];
+		hist[i] = run;
+		run += c;
+	}
+}
+
+// Stable: inside a block, elements keep their order within a digit
+__kernel __attribute__((reqd_work_group_size(SORT_WG, 1, 1)))
+void radixScatter(
+	__global const uint* keys,
+	__global const uint* values,
+	__global const uint* command,
+	const uint shift,
+	__global const uint* hist,
+	__global uint* keysOut,
+	__global uint* valuesOut)
+{
+	__local uint counts[SORT_RADIX * SORT_WG];
+	__local uint partial[SORT_WG];
+	__local uint start[SORT_RADIX];
+
+	uint n = command[0];
+	uint lid = get_local_id(0);
+	countDigits(keys, n, shift, counts);
+
+	// Rank of the first element of each work-item in its digit, in the block
+	uint sum = 0;
+	for (uint k = 0; k < SORT_RADIX; k++)
+		sum += counts[lid * SORT_RADIX + k];
+	uint run = scanGroup(partial, sum);
+	for (uint k = 0; k < SORT_RADIX; k++) {
+		uint c = counts[lid * SORT_RADIX + k];
+		counts[lid * SORT_RADIX + k] = run;
+		run += c;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if (lid < SORT_RADIX)
+		start[lid] = counts[lid * SORT_WG];
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint group = get_group_id(0);
+	uint groups = get_num_groups(0);
+	uint base = (group * SORT_WG + lid) * SORT_ITEMS;
+	for (uint k = 0; k < SORT_ITEMS && base + k < n; k++) {
+		uint key = keys[base + k];
+		uint d = (key >> shift) & (SORT_RADIX - 1);
+		uint dst = hist[d * groups + group] + counts[d * SORT_WG + lid]++ - start[d];
+		keysOut[dst] = key;
+		valuesOut[dst] = values[base + k];
+	}
+}
+
+// Motion trails: trail t follows particle t * stride, its ring of length
+// positions gets the current one at slot head. fill: a new ring, every slot
+// takes the current position, nothing is drawn from a stale history.
+__kernel void recordTrails(
+	__global const float4* positions,
+	const uint stride,
+	const uint count,
+	__global float4* trail,
+	const uint length,
+	const uint head,
+	const uint fill)
+{
+	uint t = get_global_id(0);
+	if (t >= count) return;
+
+	float4 p = (float4)(positions[t * stride].xyz, 1.0f);
+	__global float4* ring = trail + (size_t)t * length;
+	if (fill) {
+		for (uint k = 0; k < length; k++)
+			ring[k] = p;
+	} else
+		ring[head] = p;
+}
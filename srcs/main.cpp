@@ -6,7 +6,7 @@
 /*   By: lde-merc <lde-merc@student.42.fr>          +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/12/10 09:36:26 by lde-merc          #+#    #+#             */
-/*   Updated: 2026/02/11 16:21:38 by lde-merc         ###   ########.fr       */
+/*   Updated: 2026/10/19 09:59:37 by lde-merc         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -26,6 +26,8 @@ int main(int argc, char **argv) {
 		std::cerr << "\033[31mOpenGl error:\033[m" << std::endl << e.what() << std::endl;
 	} catch (openClError &e) {
 		std::cerr << "\033[31mOpenCl error:\033[m" << std::endl << e.what() << std::endl;
+	} catch (fileError &e) {
+		std::cerr << "\033[31mFile error:\033[m" << std::endl << e.what() << std::endl;
 	} catch (std::runtime_error &e) {
 		std::cerr << e.what() << std::endl;
 	}